@@ -35,52 +35,328 @@
 
 #include <msp430.h>
 #include "rtckit.h"
+#include "rtckit_arith.h"
+#include "rtckit_hw.h"
+#include "rtckit_isr.h"
 
 /// Data variables
+#ifndef RTCKIT_CHECKPOINT_INTERVAL
+// Kept in FRAM so the time and alarms survive a reset.  With RTCKIT_CHECKPOINT_INTERVAL they
+// live in SRAM instead, and only the checkpoint goes to this section.
 #pragma DATA_SECTION(rtcepoch, RTCKIT_STORE_VARIABLES_IN_SECTION)
+#ifdef RTCKIT_LEGACY_ALARMS
+#pragma DATA_SECTION(rtcalarm0, RTCKIT_STORE_VARIABLES_IN_SECTION)
+#pragma DATA_SECTION(rtcalarm0_incr, RTCKIT_STORE_VARIABLES_IN_SECTION)
+#pragma DATA_SECTION(rtcalarm1, RTCKIT_STORE_VARIABLES_IN_SECTION)
+#pragma DATA_SECTION(rtcalarm1_incr, RTCKIT_STORE_VARIABLES_IN_SECTION)
+#endif
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+#pragma DATA_SECTION(rtc_alarms, RTCKIT_STORE_VARIABLES_IN_SECTION)
+#pragma DATA_SECTION(rtc_alarm_queue, RTCKIT_STORE_VARIABLES_IN_SECTION)
+#pragma DATA_SECTION(rtc_alarm_queued, RTCKIT_STORE_VARIABLES_IN_SECTION)
+#endif
+#endif /* ifndef RTCKIT_CHECKPOINT_INTERVAL */
+
 volatile unsigned long rtcepoch;
 
-#pragma DATA_SECTION(rtcalarm0, RTCKIT_STORE_VARIABLES_IN_SECTION)
+#ifdef RTCKIT_DAYSEC
+volatile unsigned int rtc_day;
+volatile unsigned long rtc_sod;
+/// The rtcepoch value rtc_day/rtc_sod stand for - tells when rtcepoch was written under them
+volatile unsigned long rtc_daysec_epoch;
+#endif
+
+#ifdef RTCKIT_LEGACY_ALARMS
 volatile unsigned long rtcalarm0;
-#pragma DATA_SECTION(rtcalarm0_incr, RTCKIT_STORE_VARIABLES_IN_SECTION)
 volatile unsigned long rtcalarm0_incr;
-#pragma DATA_SECTION(rtcalarm1, RTCKIT_STORE_VARIABLES_IN_SECTION)
 volatile unsigned long rtcalarm1;
-#pragma DATA_SECTION(rtcalarm1_incr, RTCKIT_STORE_VARIABLES_IN_SECTION)
 volatile unsigned long rtcalarm1_incr;
+#endif /* ifdef RTCKIT_LEGACY_ALARMS */
+
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+/// Alarm table entries, indexed by alarm ID
+volatile struct rtcAlarm rtc_alarms[RTCKIT_ALARM_TABLE_SIZE];
+/// IDs of the armed alarms, sorted by trigger time - RTC_ISR only looks at rtc_alarm_queue[0]
+volatile unsigned char rtc_alarm_queue[RTCKIT_ALARM_TABLE_SIZE];
+volatile unsigned char rtc_alarm_queued;
+
+volatile unsigned int rtc_alarm_triggered;
+
+/// Works out the next trigger time of an alarm armed by rtc_alarm_set_rearm(), NULL for the others
+static rtcAlarmRearm volatile rtc_alarm_rearm[RTCKIT_ALARM_TABLE_SIZE];
+/** Alarms whose re-arm function rtc_dispatch() is to run, one bit per ID, and the epoch to
+ *  run it from - rtc_cal_next() may walk years of days, too long for RTC_ISR
+ */
+static volatile unsigned int rtc_alarm_rearm_due;
+static volatile unsigned long rtc_alarm_rearm_from[RTCKIT_ALARM_TABLE_SIZE];
+#endif /* if RTCKIT_ALARM_TABLE_SIZE > 0 */
+
+#if defined(RTCKIT_LEGACY_ALARMS) || RTCKIT_ALARM_TABLE_SIZE > 0
+#ifdef RTCKIT_LEGACY_ALARMS
+volatile struct rtcAlarmState rtc_legacy_state[2];
+#endif
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+static volatile struct rtcAlarmState rtc_alarm_state[RTCKIT_ALARM_TABLE_SIZE];
+#endif
+#endif
+
+#ifdef RTCKIT_CALLBACKS
+volatile struct rtcHandlerEntry rtc_tick_handler;
+#ifdef RTCKIT_LEGACY_ALARMS
+volatile struct rtcHandlerEntry rtc_legacy_handlers[2];
+#endif
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+volatile struct rtcHandlerEntry rtc_alarm_handlers[RTCKIT_ALARM_TABLE_SIZE];
+#endif
+
+volatile struct rtcPendingEvent rtc_pending[RTCKIT_PENDING_QUEUE_SIZE];
+volatile unsigned char rtc_pending_head, rtc_pending_tail;
+#endif /* ifdef RTCKIT_CALLBACKS */
+
+#ifdef RTCKIT_CHECKPOINT_INTERVAL
+#pragma DATA_SECTION(rtc_ckpt, RTCKIT_STORE_VARIABLES_IN_SECTION)
+struct rtcCheckpoint rtc_ckpt;
+
+/// Seconds the time restored by rtc_init() may be behind, not counting time spent powered off
+static unsigned long rtc_ckpt_uncertainty;
+#endif /* ifdef RTCKIT_CHECKPOINT_INTERVAL */
 
 volatile unsigned int rtc_status;
 
+/// Bumped by every update RTC_ISR makes, so readers can tell when they raced with one
+volatile unsigned int rtc_seq;
 
-const struct rtcMonthInfo monthInfo[12] =
-{
-    {31, "Jan", "January"},
-    {28, "Feb", "February"},
-    {31, "Mar", "March"},
-    {30, "Apr", "April"},
-    {31, "May", "May"},
-    {30, "Jun", "June"},
-    {31, "Jul", "July"},
-    {31, "Aug", "August"},
-    {30, "Sep", "September"},
-    {31, "Oct", "October"},
-    {30, "Nov", "November"},
-    {31, "Dec", "December"}
-};
+#ifdef RTCKIT_STATS
+/// Counters behind rtc_stats() - all but the cache ones are only written by RTC_ISR
+volatile struct rtcStats rtc_st;
+#ifdef RTCKIT_STATS_TIMER
+/// RTCKIT_STATS_TIMER on entry to RTC_ISR - see RTCKIT_STAT_ISR_ENTER() in rtckit_isr.h
+unsigned int rtc_isr_t0;
+#endif
+#endif
+
+/// RTC counts per second - rtc_counts_per_tick for each of the rtc_tick_hz ticks
+unsigned int rtc_counts_per_sec;
+/// RTC counts per tick, as programmed into RTCMOD by rtc_init_ex()
+unsigned int rtc_counts_per_tick;
+/// Ticks per second - RTC_ISR only advances rtcepoch on every rtc_tick_hz'th
+unsigned int rtc_tick_hz;
+/// Ticks into the current second, 0 to rtc_tick_hz-1
+volatile unsigned int rtc_subtick;
+/// The RTCPS divider in use
+static unsigned int rtc_prescale_div;
+/// The clock source rtc_init() was given, without RTC_INIT_TICKLESS
+static unsigned int rtc_clock;
+#if RTCKIT_BACKEND == RTCKIT_BACKEND_WDT
+/// Source cycles per WDT interval - rtc_subtick counts cycles, and steps by this much
+unsigned int rtc_tick_step;
+#endif
 
-const struct rtcDayInfo dayInfo[7] =
+#ifdef RTCKIT_TICKLESS
+/// Whole seconds covered by the RTC counter period now running
+volatile unsigned int rtc_tickless_period;
+/// The longest period the 16-bit RTCMOD can hold, in seconds
+unsigned int rtc_tickless_max;
+#endif
+
+/// Fraction of a count per second, Q16, spread over the periods by rtc_trim() - see rtc_vlo_calibrate()
+volatile unsigned int rtc_trim_frac;
+/// Accumulated fraction not yet added to a period, Q16
+volatile unsigned long rtc_trim_acc;
+/// Extra counts programmed into the running period
+volatile unsigned int rtc_trim_extra;
+
+/// Counts by which RTCCNT lags the time within the running period - one restarted part-way
+/// through a second, by rtc_set_time_precise() or in tickless mode, still counts from 0
+volatile unsigned int rtc_cnt_offset;
+/// Counts still to take out of the coming periods for rtc_adjtime() - negative to add
+volatile long rtc_slew;
+/// Most counts rtc_adjtime() takes out of or adds to one second, about 500ppm
+unsigned int rtc_slew_step;
+/// RTCMOD holds something other than rtc_counts_per_tick - 1 for the next period
+volatile unsigned char rtc_mod_dirty;
+#ifdef RTCKIT_TICKLESS
+/// Counts rtc_adjtime() took out of the running tickless period
+volatile int rtc_slew_applied;
+#endif
+
+#ifdef RTCKIT_LPM35
+#ifndef RTCKIT_TICKLESS
+#error "RTCKIT_LPM35 needs RTCKIT_TICKLESS - the RTC has to run straight to the next event"
+#endif
+/// RTC_ISR's SRAM state, as rtc_shutdown() left it
+struct rtcLpm35State
 {
-    {"Sun", "Sunday"},
-    {"Mon", "Monday"},
-    {"Tue", "Tuesday"},
-    {"Wed", "Wednesday"},
-    {"Thu", "Thursday"},
-    {"Fri", "Friday"},
-    {"Sat", "Saturday"}
+    unsigned int magic;    /* RTCKIT_LPM35_MAGIC once completely written */
+    unsigned int status;
+    unsigned int period;   /* rtc_tickless_period */
+    unsigned int offset;   /* rtc_cnt_offset      */
+    unsigned int counts_per_sec;
+    unsigned int prescale_div;
+    unsigned int clock;    /* rtc_clock           */
+    unsigned int tickless_max;
+    unsigned int trim_frac;
+    unsigned int trim_extra;
+    unsigned long trim_acc;
+    long slew;
+    unsigned int slew_step;
+    int slew_applied;
+    rtcWakeHandler wake_fn;
 };
+#define RTCKIT_LPM35_MAGIC 0x4C35
+
+#pragma DATA_SECTION(rtc_lpm35, RTCKIT_STORE_VARIABLES_IN_SECTION)
+static struct rtcLpm35State rtc_lpm35;
+#endif /* ifdef RTCKIT_LPM35 */
+
+
+// FRAM checkpoint
+#ifdef RTCKIT_CHECKPOINT_INTERVAL
+
+/// Copy the live variables to the checkpoint, with interrupts already disabled
+void rtc_checkpoint_save(unsigned int clean)
+{
+    #if RTCKIT_ALARM_TABLE_SIZE > 0
+    unsigned int i;
+    #endif
+    #ifdef DFWP
+    unsigned int prot = SYSCFG0 & 0x00FF;
+
+    SYSCFG0 = FRWPPW | (prot & ~DFWP);  // Information memory is only writable during the copy
+    #endif
+    rtc_ckpt.magic = 0;  // A reset in the middle of the copy leaves it marked invalid
+    rtc_ckpt.clean = clean;
+    rtc_ckpt.epoch = rtcepoch;
+    #ifdef RTCKIT_LEGACY_ALARMS
+    rtc_ckpt.alarm0 = rtcalarm0;
+    rtc_ckpt.alarm0_incr = rtcalarm0_incr;
+    rtc_ckpt.alarm1 = rtcalarm1;
+    rtc_ckpt.alarm1_incr = rtcalarm1_incr;
+    #endif
+    #if RTCKIT_ALARM_TABLE_SIZE > 0
+    for (i = 0; i < RTCKIT_ALARM_TABLE_SIZE; i++) {
+        rtc_ckpt.alarms[i].when = rtc_alarms[i].when;
+        rtc_ckpt.alarms[i].incr = rtc_alarms[i].incr;
+        rtc_ckpt.queue[i] = rtc_alarm_queue[i];
+    }
+    rtc_ckpt.queued = rtc_alarm_queued;
+    #endif
+    rtc_ckpt.magic = RTCKIT_CHECKPOINT_MAGIC;
+    #ifdef DFWP
+    SYSCFG0 = FRWPPW | prot;
+    #endif
+}
+
+/// Reload the live variables from a valid checkpoint; returns 0 if there wasn't one
+static int rtc_checkpoint_restore(void)
+{
+    #if RTCKIT_ALARM_TABLE_SIZE > 0
+    unsigned int i;
+    #endif
+    #ifdef DFWP
+    unsigned int prot;
+    #endif
+
+    if (rtc_ckpt.magic != RTCKIT_CHECKPOINT_MAGIC) {
+        return 0;
+    }
+    rtcepoch = rtc_ckpt.epoch;
+    #ifdef RTCKIT_LEGACY_ALARMS
+    rtcalarm0 = rtc_ckpt.alarm0;
+    rtcalarm0_incr = rtc_ckpt.alarm0_incr;
+    rtcalarm1 = rtc_ckpt.alarm1;
+    rtcalarm1_incr = rtc_ckpt.alarm1_incr;
+    #endif
+    #if RTCKIT_ALARM_TABLE_SIZE > 0
+    for (i = 0; i < RTCKIT_ALARM_TABLE_SIZE; i++) {
+        rtc_alarms[i].when = rtc_ckpt.alarms[i].when;
+        rtc_alarms[i].incr = rtc_ckpt.alarms[i].incr;
+        rtc_alarm_queue[i] = rtc_ckpt.queue[i];
+    }
+    rtc_alarm_queued = rtc_ckpt.queued;
+    #endif
+    rtc_ckpt_uncertainty = rtc_ckpt.clean ? 0 : RTCKIT_CHECKPOINT_INTERVAL;
+
+    // The next reset can only trust this checkpoint as far as the interval allows
+    #ifdef DFWP
+    prot = SYSCFG0 & 0x00FF;
+    SYSCFG0 = FRWPPW | (prot & ~DFWP);
+    #endif
+    rtc_ckpt.clean = 0;
+    #ifdef DFWP
+    SYSCFG0 = FRWPPW | prot;
+    #endif
+    return 1;
+}
+
+void rtc_checkpoint(void)
+{
+    RTCKIT_CRITICAL_ENTER();
+    rtc_checkpoint_save(1);
+    RTCKIT_CRITICAL_EXIT();
+}
+
+unsigned long rtc_checkpoint_uncertainty(void)
+{
+    return rtc_ckpt_uncertainty;
+}
+#endif /* ifdef RTCKIT_CHECKPOINT_INTERVAL */
 
 // RTC hardware implementation
 
+/// Prescaler settings rtc_init_ex() chooses between, with the divider each one gives - see rtckit_hw.h
+static const struct
+{
+    unsigned int bits;
+    unsigned int div;
+} rtc_prescalers[] = {
+    RTC_HW_PRESCALERS
+};
+
+/// Below this many counts per tick, a larger prescaler is no longer preferred at equal error
+#define RTCKIT_MIN_RESOLUTION 100
+
+#if defined(__MSP430_HAS_CS__) && defined(DCORSEL_7) && defined(RTC_CLOCK_SMCLK)
+/// How fast is SMCLK?  Guessed from the DCORSEL and DIVS bits; 0 if it isn't DCO-derived
+static unsigned long rtc_smclk_guess(void)
+{
+    unsigned long speed;
+
+    if ( (CSCTL4 & SELMS_7) != SELMS_0 ) {
+        return 0;  // We don't really support SMCLK that's not DCO-derived.
+    }
+    // First, how fast is DCOCLK-
+    switch (CSCTL1 & DCORSEL_7) {
+    case DCORSEL_0:
+        speed = 1000000;
+        break;
+    case DCORSEL_1:
+        speed = 2000000;
+        break;
+    case DCORSEL_2:
+        speed = 4000000;
+        break;
+    case DCORSEL_3:
+        speed = 8000000;
+        break;
+    case DCORSEL_4:
+        speed = 12000000;
+        break;
+    case DCORSEL_5:
+        speed = 16000000;
+        break;
+    case DCORSEL_6:
+        speed = 20000000;
+        break;
+    default:
+        speed = 24000000;
+        break;
+    }
+    // DIVS selects a divider of 1, 2, 4 or 8
+    return speed >> ((CSCTL5 & DIVS_3) >> 4);
+}
+#endif /* if defined __MSP430_HAS_CS__, DCORSEL_7 and RTC_CLOCK_SMCLK */
+
 /** Initialize RTC peripheral
  *  For RTC_CLK_SMCLK, the speed is guessed using DCOCLK bits and DIVS divider bits.
  *
@@ -89,263 +365,1394 @@ const struct rtcDayInfo dayInfo[7] =
  */
 void rtc_init(unsigned int rtc_clock_source)
 {
-    rtc_status = 0;
-    RTCCTL &= ~RTCIF;
-    switch (rtc_clock_source) {
+    rtc_init_ex(rtc_clock_source, 0, 1, NULL);
+}
+
+int rtc_init_ex(unsigned int rtc_clock_source, unsigned long source_hz, unsigned int tick_hz,
+                long *error_ppm)
+{
+    unsigned int i, best = 0, counts = 0;
+    #if RTCKIT_BACKEND != RTCKIT_BACKEND_WDT
+    unsigned int limit = 0xFFFF;
+    unsigned long div_hz, c, rate, span, off, ppm, best_ppm = 0xFFFFFFFFUL;
+    #endif
+    long err = 0;
+
+    // Nominal speed of the source when the caller doesn't know better
+    switch (rtc_clock_source & ~RTC_INIT_TICKLESS) {
     case RTC_CLOCK_XT1CLK:
-        RTCCTL = RTCSS__XT1CLK | RTCPS__256;
-        RTCMOD = 32768 / 256;
+        if (source_hz == 0) {
+            source_hz = 32768;
+        }
         break;
+    #ifdef RTC_CLOCK_VLOCLK
     case RTC_CLOCK_VLOCLK:
-        RTCCTL = RTCSS__VLOCLK | RTCPS__100;
-        RTCMOD = 10000 / 100;
+        if (source_hz == 0) {
+            source_hz = 10000;
+        }
         break;
-    #ifdef __MSP430_HAS_CS__
+    #endif
+    #ifdef RTC_CLOCK_SMCLK
     case RTC_CLOCK_SMCLK:
-        if ( (CSCTL4 & SELMS_7) != SELMS_0 ) {
-            rtc_status |= RTC_GENERAL_ERROR;
-            return;  // Error condition - we don't really support SMCLK that's not DCO-derived.
-        }
-        // How fast is SMCLK?  First, how fast is DCOCLK-
-        unsigned long speed;
-        switch (CSCTL1 & DCORSEL_7) {
-        case DCORSEL_0:
-            speed = 1000000;
-            break;
-        case DCORSEL_1:
-            speed = 2000000;
-            break;
-        case DCORSEL_2:
-            speed = 4000000;
-            break;
-        case DCORSEL_3:
-            speed = 8000000;
-            break;
-        case DCORSEL_4:
-            speed = 12000000;
-            break;
-        case DCORSEL_5:
-            speed = 16000000;
-            break;
-        case DCORSEL_6:
-            speed = 20000000;
-            break;
-        case DCORSEL_7:
-            speed = 24000000;
-            break;
+        #if defined(__MSP430_HAS_CS__) && defined(DCORSEL_7)
+        if (source_hz == 0) {
+            source_hz = rtc_smclk_guess();  // FR4xxx/2xxx clock system only
         }
-        // Get SMCLK divider
-        speed = speed / ( (CSCTL5 & DIVS_3) >> 4 );
-        speed /= 1000;  // Using RTCPS__1000 divider
-        RTCCTL = RTCSS__SMCLK | RTCPS__1000;
-        RTCMOD = (unsigned int)speed;  // Should be 24000 at the highest now.
+        #endif
         break;
-    #endif /* ifdef __MSP430_HAS_CS__ for FR4xxx/2xxx chips */
+    #endif
     default:
-        rtc_status |= RTC_GENERAL_ERROR;
-        return;  // Error condition - should never get here
+        source_hz = 0;  // Error condition - should never get here
+    }
+    if (rtc_clock_source & RTC_INIT_TICKLESS) {
+        // Tickless periods run to whole seconds only, and need room for several of them
+        if (tick_hz != 1) {
+            source_hz = 0;
+        }
+        #if RTCKIT_BACKEND != RTCKIT_BACKEND_WDT
+        limit = 0x7FFF;
+        #endif
+    }
+    if (source_hz != 0 && tick_hz != 0 && tick_hz <= 1024) {
+        #if RTCKIT_BACKEND == RTCKIT_BACKEND_WDT
+        // There's no modulo to pick: take the longest interval that still interrupts tick_hz
+        // times a second.  rtc_subtick counts source cycles, so the rate is exact.
+        for (i = 0; i < sizeof(rtc_prescalers) / sizeof(rtc_prescalers[0]); i++) {
+            if ((unsigned long)rtc_prescalers[i].div * tick_hz <= source_hz &&
+                source_hz + rtc_prescalers[i].div <= 0x10000UL) {
+                best = i;
+                counts = (unsigned int)source_hz;
+            }
+        }
+        #else
+        // Try every prescaler, rounding the modulo to the nearest count.  The closest rate wins;
+        // at equal error the larger prescaler does, as long as it keeps RTCKIT_MIN_RESOLUTION
+        // counts per tick - the counter is clocked less often and draws less.
+        for (i = 0; i < sizeof(rtc_prescalers) / sizeof(rtc_prescalers[0]); i++) {
+            div_hz = (unsigned long)rtc_prescalers[i].div * tick_hz;
+            c = (source_hz + div_hz / 2) / div_hz;
+            if (c < 2 || c * tick_hz > limit) {
+                continue;
+            }
+            // The rate this gives, in source cycles per second, and how far off it is in ppm.
+            // c is rounded, so off is at most rate/4: with the divisor brought under 2^22 -
+            // which costs well under 1ppm - off * 1000000 / rate goes in two steps of 1000, in
+            // 32 bits and without the compiler's 64-bit divide.
+            rate = c * div_hz;
+            off = (source_hz > rate) ? source_hz - rate : rate - source_hz;
+            for (span = rate; span >= 0x400000UL; span >>= 1) {
+                off >>= 1;
+            }
+            off *= 1000;
+            ppm = (off / span) * 1000 + ((off % span) * 1000 + span / 2) / span;
+            if (ppm < best_ppm ||
+                (ppm == best_ppm && (c >= RTCKIT_MIN_RESOLUTION ?
+                                     (counts < RTCKIT_MIN_RESOLUTION || rtc_prescalers[i].div > rtc_prescalers[best].div) :
+                                     c > counts))) {
+                best_ppm = ppm;
+                err = (source_hz > rate) ? (long)ppm : -(long)ppm;  // Positive: the ticks come too fast
+                best = i;
+                counts = (unsigned int)c;
+            }
+        }
+        #endif
+    }
+    if (counts != 0 && error_ppm != NULL) {
+        *error_ppm = err;
     }
-    RTCCTL |= RTCSR;
-    RTCCTL |= RTCIE;
+    return rtc_init_preset(rtc_clock_source, rtc_prescalers[best].div, counts, tick_hz);
 }
 
-// RTC hardware ISR
-#ifdef RTCKIT_LIBRARY_PROVIDES_ISR
+#if RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+/** Read the RTC_C calendar - no conversion, the hardware keeps the fields
+ *  The registers count on asynchronously, so they are read until the seconds come out the same
+ *  on both sides of the others.
+ */
+static void rtc_calendar_read(struct rtc_datetime *dt)
+{
+    do {
+        dt->sec = RTCSEC;
+        dt->min = RTCMIN;
+        dt->hour = RTCHOUR;
+        dt->wday = RTCDOW;
+        dt->mday = RTCDAY;
+        dt->mon = RTCMON - 1;
+        dt->year = RTCYEAR;
+    } while (dt->sec != RTCSEC);
+    dt->yday = rtc_yday_before_month[rtc_is_leap(dt->year)][dt->mon] + dt->mday - 1;
+}
 
-#if defined(__MSP430_HAS_RTC__)
-#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
-#pragma vector=RTC_VECTOR
-__interrupt void RTC_ISR(void)
-#elif defined(__GNUC__)
-void __attribute__ ((interrupt(RTC_VECTOR))) RTC_ISR (void)
-#else
-#error Compiler not supported!
+/** Set the RTC_C calendar to epoch, subsec counts into its second
+ *  0xFFFF for subsec keeps the RT1PS:RT0PS phase the calendar had.
+ */
+static void rtc_calendar_set(unsigned long epoch, unsigned int subsec)
+{
+    struct rtc_datetime dt;
+
+    rtc_interpret_dt(epoch, &dt);
+    RTCCTL0_H = RTCKEY_H;
+    RTCCTL13 |= RTCHOLD;
+    if (subsec == 0xFFFF) {
+        subsec = RTCPS;
+    }
+    RTCYEAR = dt.year;
+    RTCMON = dt.mon + 1;
+    RTCDAY = dt.mday;
+    RTCDOW = dt.wday;
+    RTCHOUR = dt.hour;
+    RTCMIN = dt.min;
+    RTCSEC = dt.sec;
+    RTCPS = subsec;  // Last - a calendar write may have reset the prescalers
+    RTCCTL13 &= ~RTCHOLD;
+    RTCCTL0_H = 0;
+}
+
+/** Start the RTC_C calendar at rtcepoch - or, if it kept running through the reset (only a BOR
+ *  stops it), take rtcepoch from it instead: it has kept better time than the copy in FRAM.
+ */
+static void rtc_calendar_start(void)
+{
+    struct rtc_datetime dt;
+
+    if (!(RTCCTL13 & RTCHOLD)) {
+        rtc_calendar_read(&dt);
+        rtcepoch = rtc_days_from_civil(dt.year, dt.mon, dt.mday) * 86400UL +
+                   (unsigned long)dt.hour * 3600 + (unsigned int)dt.min * 60 + dt.sec;
+    } else {
+        RTCCTL0_H = RTCKEY_H;
+        RTCCTL13 = RTCHOLD | RTCMODE;  // Binary calendar mode
+        RTCCTL0_H = 0;
+        rtc_calendar_set(rtcepoch, 0);
+    }
+    RTCCTL0_H = RTCKEY_H;
+    RTCCTL0_L = RTCRDYIE;  // Clears the flags too
+    RTCCTL0_H = 0;
+}
+#endif /* if RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C */
+
+#ifdef RTCKIT_LPM35
+static int rtc_lpm35_restore(void);
 #endif
+
+int rtc_init_preset(unsigned int rtc_clock_source, unsigned int prescaler, unsigned int counts,
+                    unsigned int tick_hz)
+{
+    unsigned int i = 0;
+
+    #ifdef RTCKIT_LPM35
+    if (rtc_lpm35_restore()) {
+        return 0;  // Woken from LPM3.5 - the RTC is still running as rtc_shutdown() left it
+    }
+    #endif
+    rtc_status = 0;
+    RTC_HW_CLEAR();
+    #ifdef RTCKIT_CHECKPOINT_INTERVAL
+    if (rtcepoch == 0 && rtc_checkpoint_restore()) {
+        rtc_status |= RTC_EPOCH_RESTORED;
+    }
+    #endif
+    while (i < sizeof(rtc_prescalers) / sizeof(rtc_prescalers[0]) && rtc_prescalers[i].div != prescaler) {
+        i++;
+    }
+    if (i == sizeof(rtc_prescalers) / sizeof(rtc_prescalers[0]) || counts < 2 || tick_hz == 0 ||
+        #if RTCKIT_BACKEND == RTCKIT_BACKEND_WDT
+        // counts is the source frequency: the interval has to fit tick_hz times into it
+        (unsigned long)prescaler * tick_hz > counts || (unsigned long)counts + prescaler > 0x10000UL ||
+        #elif RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+        counts != 32768U || tick_hz != 1 ||
+        #else
+        (unsigned long)counts * tick_hz > 0xFFFF ||
+        #endif
+        ((rtc_clock_source & RTC_INIT_TICKLESS) && (tick_hz != 1 || counts > 0x7FFF))) {
+        rtc_status |= RTC_GENERAL_ERROR;
+        return -1;
+    }
+
+    rtc_clock = rtc_clock_source & ~RTC_INIT_TICKLESS;
+    #if RTCKIT_BACKEND != RTCKIT_BACKEND_RTC_C
+    RTC_HW_SETUP(rtc_clock, rtc_prescalers[i].bits);
+    #endif
+    #if RTC_HW_HAS_MOD
+    RTC_HW_MOD = counts - 1;  // The counter runs from 0 up to and including RTC_HW_MOD
+    #endif
+    rtc_prescale_div = prescaler;
+    #if RTCKIT_BACKEND == RTCKIT_BACKEND_WDT
+    rtc_tick_step = prescaler;
+    rtc_tick_hz = counts;
+    rtc_counts_per_tick = 1;
+    rtc_counts_per_sec = counts;
+    #else
+    rtc_tick_hz = tick_hz;
+    rtc_counts_per_tick = counts;
+    rtc_counts_per_sec = counts * tick_hz;
+    #endif
+    rtc_subtick = 0;
+    rtc_trim_frac = 0;
+    rtc_trim_acc = 0;
+    rtc_trim_extra = 0;
+    rtc_cnt_offset = 0;
+    rtc_slew = 0;
+    rtc_mod_dirty = 0;
+    rtc_slew_step = rtc_counts_per_sec >> 11;
+    if (rtc_slew_step == 0) {
+        rtc_slew_step = 1;
+    }
+    if (rtc_slew_step > counts / 4) {
+        rtc_slew_step = counts / 4;  // Keep a slewed tick within a quarter of its length
+    }
+    #if RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+    rtc_slew_step = 0;  // Nothing to slew with - rtc_adjtime() does nothing
+    #endif
+    #ifdef RTCKIT_TICKLESS
+    rtc_tickless_period = 1;
+    rtc_slew_applied = 0;
+    // + 1 leaves room for rtc_trim(), + rtc_slew_step for rtc_adjtime()
+    rtc_tickless_max = 0xFFFF / (rtc_counts_per_sec + 1 + rtc_slew_step);
+    if (rtc_clock_source & RTC_INIT_TICKLESS) {
+        rtc_status |= RTC_TICKLESS;
+    }
+    #endif
+    #if RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+    rtc_calendar_start();
+    #else
+    RTC_HW_RESTART();
+    RTC_HW_CLEAR();
+    RTC_HW_IRQ_ON();
+    #endif
+    return 0;
+}
+
+/** Sequence-counter read of the epoch, status and RTC counter - no interrupt masking.
+ *  If RTC_ISR runs at any point during the reads, rtc_seq changes and they are retried.
+ *  A rollover that RTC_ISR hasn't accounted for yet - because interrupts are disabled or we're
+ *  inside another ISR - shows up as RTCIF, and is added in here instead.
+ */
+void rtc_snapshot(struct rtcSnapshot *snap)
 {
-    if (RTCIV & RTCIV_RTCIF) {
-        int do_wakeup = 0;
+    unsigned long now;
+    unsigned int seq, status, cnt, secs, sub, off, period = 1;
 
-        rtc_status |= RTC_TICK;
-        rtcepoch++;
-        if (rtc_status & RTC_TICK_DOES_WAKEUP) {
-            do_wakeup = 1;
+    do {
+        seq = rtc_seq;
+        now = rtcepoch;
+        status = rtc_status;
+        sub = rtc_subtick;
+        off = rtc_cnt_offset;
+        cnt = 0;
+        if (rtc_counts_per_sec == 0) {
+            continue;  // rtc_init() hasn't run - rtcepoch is kept by user code
         }
-        if (rtcalarm0 > 0 && rtcepoch == rtcalarm0) {
-            rtc_status |= RTCALARM_0_TRIGGERED;
-            if (rtcalarm0_incr > 0) {
-                rtcalarm0 += rtcalarm0_incr;
-            }
-            do_wakeup = 1;
+        period = 1;
+        #ifdef RTCKIT_TICKLESS
+        if (status & RTC_TICKLESS) {
+            period = rtc_tickless_period;
         }
-        if (rtcalarm1 > 0 && rtcepoch == rtcalarm1) {
-            rtc_status |= RTCALARM_1_TRIGGERED;
-            if (rtcalarm1_incr > 0) {
-                rtcalarm1 += rtcalarm1_incr;
+        #endif
+        cnt = rtc_read_cnt();
+        if (RTC_HW_PENDING()) {
+            // The counter rolled over, before or after we read it - count the period and
+            // take a fresh reading.
+            sub += RTC_TICK_STEP;
+            if (sub >= rtc_tick_hz) {
+                sub -= rtc_tick_hz;
+                now += period;
             }
-            do_wakeup = 1;
+            off = 0;  // The new period is a plain one until RTC_ISR says otherwise
+            cnt = rtc_read_cnt();
         }
-        if (do_wakeup) {
-            __bic_SR_register_on_exit(LPM3_bits);
+    } while (seq != rtc_seq);
+
+    cnt += off;
+    secs = 0;
+    if (cnt != 0 && cnt >= rtc_counts_per_sec) {
+        // A period is longer than a second in tickless mode.  rtc_trim() adds its extra counts
+        // at the end of a period; divide by the trimmed rate so they are spread over its seconds.
+        if (rtc_trim_frac != 0) {
+            secs = (unsigned int)(((unsigned long)cnt << 16) /
+                                  (((unsigned long)rtc_counts_per_sec << 16) | rtc_trim_frac));
+        } else {
+            secs = cnt / rtc_counts_per_sec;
+        }
+        if (secs >= period) {
+            secs = period - 1;
+        }
+        cnt -= secs * rtc_counts_per_sec + (unsigned int)(((unsigned long)secs * rtc_trim_frac) >> 16);
+        if (cnt >= rtc_counts_per_sec) {
+            cnt = rtc_counts_per_sec - 1;
         }
     }
+    snap->epoch = now + secs;
+    snap->ticks = cnt + sub * rtc_counts_per_tick;
+    if (snap->ticks >= rtc_counts_per_sec && rtc_counts_per_sec != 0) {
+        snap->ticks = rtc_counts_per_sec - 1;  // The last tick of a second slewed by rtc_adjtime() runs long
+    }
+    snap->status = status;
 }
-#endif /* if defined __MSP430_HAS_RTC__ */
-#endif /* ifdef RTC_LIBRARY_PROVIDES_ISR */
 
+unsigned long rtc_now_ticks(unsigned int *ticks)
+{
+    struct rtcSnapshot snap;
 
-// RTC timestamp interpretation
+    rtc_snapshot(&snap);
+    if (ticks != NULL) {
+        *ticks = snap.ticks;
+    }
+    return snap.epoch;
+}
 
+unsigned long rtc_now_ms(unsigned int *ms)
+{
+    unsigned int ticks;
+    unsigned long now = rtc_now_ticks(&ticks);
 
-struct tm_leapyear {
-    unsigned long startOfCycle;
-    unsigned long remains;
-    unsigned int years;
-};
+    *ms = 0;
+    if (rtc_counts_per_sec != 0) {
+        *ms = (unsigned int)(((unsigned long)ticks * 1000) / rtc_counts_per_sec);
+    }
+    return now;
+}
 
-/// Function prototypes of utility helper functions
-unsigned int rtc_calculate_yday(struct tm *, unsigned long, unsigned int);
-unsigned long rtc_calculate_last_leapyear(struct tm_leapyear *, unsigned long);
+unsigned long rtc_now_frac(unsigned int *frac)
+{
+    unsigned int ticks;
+    unsigned long now = rtc_now_ticks(&ticks);
 
-/// This buffer is offered out to user functions as return value of rtc_interpret()
-static struct tm timebuf;
+    *frac = 0;
+    if (rtc_counts_per_sec != 0) {
+        *frac = (unsigned int)(((unsigned long)ticks << 16) / rtc_counts_per_sec);
+    }
+    return now;
+}
 
-struct tm * rtc_interpret(unsigned long epoch)
+unsigned int rtc_ticks_per_second(void)
 {
-    unsigned long remains_years, remains_this_year, weeks_since_epoch;
-    unsigned int days_this_year = 365;
-    long i, j;
-    unsigned int days_february = 28;
-    struct tm_leapyear leaps;
+    return rtc_counts_per_sec;
+}
+
+unsigned long rtc_get_epoch(void)
+{
+    return rtc_now_ticks(NULL);
+}
 
-    // Calculate the end of the last leap year - respecting that 1970 wasn't a leapyear, 1972 was.
-    if (rtc_calculate_last_leapyear(&leaps, epoch) == 0) {
-        return NULL;  // Invalid or unsupported date
+// Late alarms
+#if defined(RTCKIT_LEGACY_ALARMS) || RTCKIT_ALARM_TABLE_SIZE > 0
+
+/// Find the late-alarm state of an alarm, NULL if there is no such alarm
+static volatile struct rtcAlarmState * rtc_alarm_state_slot(unsigned int id)
+{
+    #ifdef RTCKIT_LEGACY_ALARMS
+    if (id == RTC_EVENT_ALARM0 || id == RTC_EVENT_ALARM1) {
+        return &rtc_legacy_state[id - RTC_EVENT_ALARM0];
     }
-    remains_years = leaps.remains / (365*86400);
-    if (remains_years > 2) {
-        days_february = 29;  // Leap year!
-        days_this_year = 366;
+    #endif
+    #if RTCKIT_ALARM_TABLE_SIZE > 0
+    if (id < RTCKIT_ALARM_TABLE_SIZE) {
+        return &rtc_alarm_state[id];
     }
-    if (remains_years > 3) {
-        remains_years--;  // Last day of a leap year!
+    #endif
+    return NULL;
+}
+
+int rtc_alarm_policy(unsigned int id, unsigned int policy)
+{
+    volatile struct rtcAlarmState *st = rtc_alarm_state_slot(id);
+
+    if (st == NULL || policy > RTC_ALARM_CATCHUP) {
+        return -1;
     }
+    st->policy = policy;
+    return 0;
+}
 
-    timebuf.tm_year = leaps.years + remains_years + 1970;
-    if (days_this_year == 366) {
-        remains_this_year = leaps.remains - (remains_years * 86400 * 365);
-    } else {
-        remains_this_year = leaps.remains - ((remains_years-1)*86400 * 365) - (86400*days_this_year);
-    }
-    timebuf.tm_yday = remains_this_year / 86400;
-
-    timebuf.tm_mon = 0;  // Starting with January, calculating up
-    i = timebuf.tm_yday;
-    j = 0;
-    while (i > -1) {
-        if (timebuf.tm_mon == 1) {  // Handle February for leap years
-            i -= days_february;
-            j += days_february;
-            timebuf.tm_mon++;
-        } else {
-            i -= monthInfo[timebuf.tm_mon].days;
-            j += monthInfo[timebuf.tm_mon++].days;
+unsigned int rtc_alarm_missed(unsigned int id, unsigned int reset)
+{
+    volatile struct rtcAlarmState *st = rtc_alarm_state_slot(id);
+    unsigned int missed;
+
+    if (st == NULL) {
+        return 0;
+    }
+    RTCKIT_CRITICAL_ENTER();
+    missed = st->missed;
+    if (reset) {
+        st->missed = 0;
+    }
+    RTCKIT_CRITICAL_EXIT();
+    return missed;
+}
+
+/** Next trigger time of a periodic alarm that triggered at "now", by its policy
+ *  Only an alarm that has fallen more than a period behind has any dividing to do.
+ */
+unsigned long rtc_alarm_advance(unsigned long when, unsigned long incr, unsigned long now,
+                                volatile struct rtcAlarmState *st)
+{
+    unsigned long behind;
+
+    if (st->policy == RTC_ALARM_CATCHUP) {
+        if (now > when) {
+            st->missed++;  // Triggered late; the next one may be due on the next tick already
         }
+        return when + incr;
     }
-    timebuf.tm_mon--;
-    if (timebuf.tm_mon == 1) {
-        j -= days_february;
-    } else {
-        j -= monthInfo[timebuf.tm_mon].days;
+    when += incr;
+    if (when <= now) {
+        behind = (now - when) / incr + 1;
+        when += behind * incr;
+        st->missed += (unsigned int)behind;
     }
-    timebuf.tm_mday = (remains_this_year - (j*86400)) / 86400 + 1;
-    i = remains_this_year - timebuf.tm_yday * 86400;  // i is now the # of seconds for today
-    timebuf.tm_hour = i / 3600;
-    j = i % 3600;
-    timebuf.tm_min = j / 60;
-    timebuf.tm_sec = j % 60;
+    return when;
+}
 
-    // Calculating time of week - use the epoch, Jan 1 1970 was on a Thursday.
-    weeks_since_epoch = epoch / (7*86400);
-    timebuf.tm_wday = (((epoch / 86400) - (weeks_since_epoch * 7)) + 4) % 7;  // 4 = Thursday, which was Jan 1 1970
+/** Bring a periodic alarm in line with a time set by rtc_set_epoch()
+ *  Stepped over, a RTC_ALARM_REALIGN alarm is left with only its last occurrence due, to
+ *  trigger on the next tick.  Stepped back from, an alarm is moved back whole periods until it
+ *  is no more than one period ahead.
+ */
+static unsigned long rtc_alarm_realign(unsigned long when, unsigned long incr, unsigned long epoch,
+                                       volatile struct rtcAlarmState *st)
+{
+    unsigned long n;
 
-    return (&timebuf);
+    if (when <= epoch) {
+        if (st->policy == RTC_ALARM_REALIGN) {
+            n = (epoch - when) / incr;
+            when += n * incr;
+            st->missed += (unsigned int)n;
+        }
+    } else if (when - epoch > incr) {
+        when -= ((when - epoch - 1) / incr) * incr;
+    }
+    return when;
 }
 
-unsigned long rtc_calculate_last_leapyear(struct tm_leapyear *buf, unsigned long epoch)
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+/// Re-aligns the alarm table - in the alarm table section further down
+static void rtc_alarm_reevaluate(unsigned long epoch);
+/// Re-arms the alarms of rtc_alarm_set_rearm() for rtc_dispatch() - in the same section
+static void rtc_alarm_rearm_run(void);
+#endif
+#endif /* RTCKIT_LEGACY_ALARMS or RTCKIT_ALARM_TABLE_SIZE > 0 */
+
+#ifdef RTCKIT_DAYSEC
+unsigned long rtc_now_daysec(unsigned int *day)
 {
-    unsigned int years = 0;
+    struct rtcSnapshot snap;
+    unsigned long sod, base;
+    unsigned int seq;
+
+    do {
+        seq = rtc_seq;
+        *day = rtc_day;
+        sod = rtc_sod;
+        base = rtc_daysec_epoch;
+        rtc_snapshot(&snap);
+    } while (seq != rtc_seq);
+
+    // snap.epoch is ahead of base by the seconds tickless mode hasn't counted into rtcepoch yet
+    return rtc_daysec_advance(snap.epoch, base, day, sod);
+}
+#endif /* ifdef RTCKIT_DAYSEC */
 
-    if (epoch < EPOCH_AFTER_FIRST_LEAPYEAR) {
-        return 0;  // We're not supporting dates before 1973
+/// Store a new rtcepoch and bring the alarms and day count into line, with interrupts disabled
+static void rtc_epoch_store(unsigned long epoch)
+{
+    rtc_seq++;
+    rtcepoch = epoch;
+    #ifdef RTCKIT_LEGACY_ALARMS
+    if (rtcalarm0 > 0 && rtcalarm0_incr > 0) {
+        rtcalarm0 = rtc_alarm_realign(rtcalarm0, rtcalarm0_incr, epoch, &rtc_legacy_state[0]);
+    }
+    if (rtcalarm1 > 0 && rtcalarm1_incr > 0) {
+        rtcalarm1 = rtc_alarm_realign(rtcalarm1, rtcalarm1_incr, epoch, &rtc_legacy_state[1]);
     }
-    unsigned long accum = 0;
+    #endif
+    #if RTCKIT_ALARM_TABLE_SIZE > 0
+    rtc_alarm_reevaluate(epoch);
+    #endif
+    #ifdef RTCKIT_DAYSEC
+    {
+        unsigned long sod;
 
-    epoch -= EPOCH_AFTER_FIRST_LEAPYEAR;
-    accum += EPOCH_AFTER_FIRST_LEAPYEAR;
-    years += 3;
-    while (epoch >= TOTAL_SECONDS_PER_LEAP_CYCLE) {
-        epoch -= TOTAL_SECONDS_PER_LEAP_CYCLE;
-        accum += TOTAL_SECONDS_PER_LEAP_CYCLE;
-        years += 4;
+        rtc_day = rtc_div86400(epoch, &sod);
+        rtc_sod = sod;
+        rtc_daysec_epoch = epoch;
     }
+    #endif
+}
+
+void rtc_set_epoch(unsigned long epoch)
+{
+    #if RTCKIT_BACKEND != RTCKIT_BACKEND_RTC_C
+    struct rtcSnapshot snap;
+    #endif
+
+    RTCKIT_CRITICAL_ENTER();
+    #if RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+    RTC_HW_CLEAR();  // A second not yet counted belongs to the old time
+    rtc_epoch_store(epoch);
+    rtc_calendar_set(epoch, 0xFFFF);
+    #else
+    // In tickless mode rtcepoch lags the time by the seconds RTCCNT has counted since RTC_ISR
+    // last ran (and by a whole period if RTC_ISR is pending) - keep that lag.
+    rtc_snapshot(&snap);
+    rtc_epoch_store(epoch - (snap.epoch - rtcepoch));
+    #endif
+    RTCKIT_CRITICAL_EXIT();
+    #ifdef RTCKIT_TICKLESS
+    rtc_tickless_update();
+    #endif
+}
+
+// Phase-aligned setting and slewing
+
+int rtc_set_time_precise(unsigned long epoch, unsigned int subsec)
+{
+    #if RTC_HW_HAS_MOD
+    unsigned int sub, rem;
+    #endif
 
-    if (buf != NULL) {
-        buf->startOfCycle = accum;
-        buf->remains = epoch;
-        buf->years = years;
+    if (rtc_counts_per_sec == 0 || subsec >= rtc_counts_per_sec) {
+        return -1;
+    }
+    RTCKIT_CRITICAL_ENTER();
+    RTC_HW_CLEAR();  // A rollover not yet counted belongs to the old time
+    rtc_slew = 0;
+    rtc_epoch_store(epoch);
+    #if RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+    rtc_calendar_set(epoch, subsec);
+    #elif RTCKIT_BACKEND == RTCKIT_BACKEND_WDT
+    // A full interval from here; rtc_subtick counts the cycles into the second
+    rtc_subtick = subsec;
+    RTC_HW_RESTART();
+    #else
+    #ifdef RTCKIT_TICKLESS
+    if (rtc_status & RTC_TICKLESS) {
+        rtc_tickless_program(subsec);
+    } else
+    #endif
+    {
+        // Restart the counter with the rest of the tick subsec falls in
+        sub = subsec / rtc_counts_per_tick;
+        rem = subsec - sub * rtc_counts_per_tick;
+        rtc_subtick = sub;
+        RTC_HW_MOD = rtc_counts_per_tick - rem - 1;
+        RTC_HW_RESTART();
+        rtc_cnt_offset = rem;
+        rtc_mod_dirty = 1;
+        #if RTC_HW_MOD_BUFFERED
+        rtc_mod_update(rtc_mod_is_last(sub));  // Written after the restart, so for the following period
+        #endif
     }
+    #endif
+    RTCKIT_CRITICAL_EXIT();
+    return 0;
+}
 
-    return accum;
+long rtc_adjtime(long delta_ms)
+{
+    long sec = delta_ms / 1000, left, slew;
+
+    if (rtc_counts_per_sec == 0 || rtc_slew_step == 0) {
+        return 0;
+    }
+    // Whole seconds and milliseconds are scaled apart, so the products stay in 32 bits: with
+    // at most 0xFFFF counts a second, 32767 seconds is as far as a long of counts reaches.
+    if (sec > 32767) {
+        sec = 32767;
+        delta_ms = sec * 1000;
+    } else if (sec < -32767) {
+        sec = -32767;
+        delta_ms = sec * 1000;
+    }
+    slew = sec * rtc_counts_per_sec + (delta_ms - sec * 1000) * (long)rtc_counts_per_sec / 1000;
+
+    RTCKIT_CRITICAL_ENTER();
+    left = rtc_slew;
+    rtc_slew = slew;
+    RTCKIT_CRITICAL_EXIT();
+
+    sec = left / (long)rtc_counts_per_sec;
+    return sec * 1000 + (left - sec * (long)rtc_counts_per_sec) * 1000 / (long)rtc_counts_per_sec;
+}
+
+// Tickless mode
+#ifdef RTCKIT_TICKLESS
+
+void rtc_tickless_update(void)
+{
+    unsigned int cnt, secs, left;
+
+    RTCKIT_CRITICAL_ENTER();
+    if ((rtc_status & RTC_TICKLESS) && !RTC_HW_PENDING()) {
+        cnt = rtc_read_cnt() + rtc_cnt_offset;
+        secs = cnt / rtc_counts_per_sec;
+        left = rtc_tickless_period * rtc_counts_per_sec + rtc_trim_extra - rtc_slew_applied - cnt;
+        // Nothing to do if the next event is no sooner than the end of the running period,
+        // or that end is too close to safely restart the counter; RTC_ISR will take care of it.
+        if (left > 1 && secs < rtc_tickless_period &&
+            rtc_tickless_gap(rtcepoch + secs) < rtc_tickless_period - secs) {
+            // The running period's extra counts fall due at its end, which is now cut short:
+            // give them back, keeping only the fraction owed for the seconds already elapsed.
+            rtc_trim_acc += ((unsigned long)rtc_trim_extra << 16) -
+                            (unsigned long)rtc_trim_frac * (rtc_tickless_period - secs);
+            rtc_slew += rtc_slew_applied;  // The new period takes it again
+            rtcepoch += secs;
+            rtc_tickless_program(cnt - secs * rtc_counts_per_sec);
+            rtc_seq++;
+        }
+    }
+    RTCKIT_CRITICAL_EXIT();
+}
+#endif /* ifdef RTCKIT_TICKLESS */
+
+// LPM3.5 shutdown
+#ifdef RTCKIT_LPM35
+
+// Where rtc_shutdown() left the time and alarms
+#ifdef RTCKIT_CHECKPOINT_INTERVAL
+#define RTC_LPM35_EPOCH  rtc_ckpt.epoch
+#define RTC_LPM35_ALARM0 rtc_ckpt.alarm0
+#define RTC_LPM35_ALARM1 rtc_ckpt.alarm1
+#define RTC_LPM35_ALARMS rtc_ckpt.alarms
+#define RTC_LPM35_QUEUE  rtc_ckpt.queue
+#define RTC_LPM35_QUEUED rtc_ckpt.queued
+#else
+#define RTC_LPM35_EPOCH  rtcepoch
+#define RTC_LPM35_ALARM0 rtcalarm0
+#define RTC_LPM35_ALARM1 rtcalarm1
+#define RTC_LPM35_ALARMS rtc_alarms
+#define RTC_LPM35_QUEUE  rtc_alarm_queue
+#define RTC_LPM35_QUEUED rtc_alarm_queued
+#endif
+
+/// Is this reset a wakeup from rtc_shutdown()?
+static int rtc_lpm35_woken(void)
+{
+    return (PMMIFG & PMMLPM5IFG) && rtc_lpm35.magic == RTCKIT_LPM35_MAGIC;
+}
+
+int rtc_shutdown(rtcWakeHandler wake_fn)
+{
+    #ifdef DFWP
+    unsigned int prot;
+    #endif
+
+    if (!(rtc_status & RTC_TICKLESS)) {
+        return -1;
+    }
+    rtc_tickless_update();  // The counter is to run to the next event
+    __disable_interrupt();
+    if (RTC_HW_PENDING()) {
+        // RTC_ISR is due - let it run first, it starts the next period
+        __enable_interrupt();
+        __no_operation();
+        __disable_interrupt();
+    }
+    #ifdef RTCKIT_CHECKPOINT_INTERVAL
+    rtc_checkpoint_save(1);
+    #endif
+    #ifdef DFWP
+    prot = SYSCFG0 & 0x00FF;
+    SYSCFG0 = FRWPPW | (prot & ~DFWP);
+    #endif
+    rtc_lpm35.magic = 0;
+    rtc_lpm35.status = rtc_status;
+    rtc_lpm35.period = rtc_tickless_period;
+    rtc_lpm35.offset = rtc_cnt_offset;
+    rtc_lpm35.counts_per_sec = rtc_counts_per_sec;
+    rtc_lpm35.prescale_div = rtc_prescale_div;
+    rtc_lpm35.clock = rtc_clock;
+    rtc_lpm35.tickless_max = rtc_tickless_max;
+    rtc_lpm35.trim_frac = rtc_trim_frac;
+    rtc_lpm35.trim_extra = rtc_trim_extra;
+    rtc_lpm35.trim_acc = rtc_trim_acc;
+    rtc_lpm35.slew = rtc_slew;
+    rtc_lpm35.slew_step = rtc_slew_step;
+    rtc_lpm35.slew_applied = rtc_slew_applied;
+    rtc_lpm35.wake_fn = wake_fn;
+    rtc_lpm35.magic = RTCKIT_LPM35_MAGIC;
+    #ifdef DFWP
+    SYSCFG0 = FRWPPW | prot;
+    #endif
+
+    PMMCTL0_H = PMMPW_H;
+    PMMCTL0_L |= PMMREGOFF;  // LPM3 with the regulator off is LPM3.5
+    __bis_SR_register(LPM3_bits | GIE);
+    __no_operation();
+
+    // Still here: LPM3.5 wasn't entered, so carry on as if nothing happened
+    PMMCTL0_L &= ~PMMREGOFF;
+    PMMCTL0_H = 0;
+    #ifdef DFWP
+    prot = SYSCFG0 & 0x00FF;
+    SYSCFG0 = FRWPPW | (prot & ~DFWP);
+    #endif
+    rtc_lpm35.magic = 0;
+    #ifdef DFWP
+    SYSCFG0 = FRWPPW | prot;
+    #endif
+    return -1;
 }
 
-unsigned long rtc_epoch(struct tm *timebuf)
+int rtc_resume(void)
 {
-    if (timebuf == NULL || timebuf->tm_year < 1973) {
+    unsigned long now;
+    unsigned int cnt, event = RTC_EVENT_WAKE;
+
+    if (!rtc_lpm35_woken()) {
         return 0;
     }
-    unsigned long epoch = EPOCH_AFTER_FIRST_LEAPYEAR;  // Starting at 1973
-    unsigned int latest_year = 1973, is_leap = 0;
+    if (rtc_lpm35.wake_fn != NULL) {
+        // The time as RTC_ISR will see it - a period further on if the wakeup was the RTC's
+        now = RTC_LPM35_EPOCH;
+        cnt = rtc_read_cnt();
+        if (RTC_HW_PENDING()) {
+            now += rtc_lpm35.period;
+            cnt = rtc_read_cnt();
+        } else {
+            cnt += rtc_lpm35.offset;
+        }
+        now += cnt / rtc_lpm35.counts_per_sec;
+        #if RTCKIT_ALARM_TABLE_SIZE > 0
+        if (RTC_LPM35_QUEUED > 0 && RTC_LPM35_ALARMS[RTC_LPM35_QUEUE[0]].when <= now) {
+            event = RTC_LPM35_QUEUE[0];
+        }
+        #endif
+        #ifdef RTCKIT_LEGACY_ALARMS
+        if (RTC_LPM35_ALARM1 > 0 && RTC_LPM35_ALARM1 <= now) {
+            event = RTC_EVENT_ALARM1;
+        }
+        if (RTC_LPM35_ALARM0 > 0 && RTC_LPM35_ALARM0 <= now) {
+            event = RTC_EVENT_ALARM0;
+        }
+        #endif
+        rtc_lpm35.wake_fn(event, now);
+    }
+    return 1;
+}
 
-    while ( (timebuf->tm_year - latest_year) >= 4 ) {
-        epoch += TOTAL_SECONDS_PER_LEAP_CYCLE;
-        latest_year += 4;
+/** Pick up the RTC where rtc_shutdown() left it, for rtc_init()
+ *  The counter has kept running, so only the SRAM state is reloaded.  A period that ended
+ *  during LPM3.5 has left RTCIF pending; RTC_ISR services it as usual once LOCKLPM5 is cleared.
+ */
+static int rtc_lpm35_restore(void)
+{
+    #ifdef DFWP
+    unsigned int prot;
+    #endif
+
+    if (!rtc_lpm35_woken()) {
+        return 0;
     }
-    if ( (timebuf->tm_year - latest_year) > 2 ) {
-        is_leap = 1;
+    rtc_status = 0;
+    #ifdef RTCKIT_CHECKPOINT_INTERVAL
+    if (rtcepoch == 0 && rtc_checkpoint_restore()) {
+        rtc_status = RTC_EPOCH_RESTORED;
     }
-    while ( (timebuf->tm_year - latest_year) > 0 ) {
-        epoch += 86400*365;
-        latest_year++;
+    #endif
+    rtc_status |= (rtc_lpm35.status & ~RTC_EPOCH_RESTORED) | RTC_LPM35_RESUMED;
+    rtc_prescale_div = rtc_lpm35.prescale_div;
+    rtc_clock = rtc_lpm35.clock;
+    rtc_tick_hz = 1;
+    rtc_counts_per_tick = rtc_lpm35.counts_per_sec;
+    rtc_counts_per_sec = rtc_lpm35.counts_per_sec;
+    rtc_subtick = 0;
+    rtc_trim_frac = rtc_lpm35.trim_frac;
+    rtc_trim_acc = rtc_lpm35.trim_acc;
+    rtc_trim_extra = rtc_lpm35.trim_extra;
+    rtc_cnt_offset = rtc_lpm35.offset;
+    rtc_slew = rtc_lpm35.slew;
+    rtc_slew_step = rtc_lpm35.slew_step;
+    rtc_mod_dirty = 0;
+    rtc_tickless_period = rtc_lpm35.period;
+    rtc_tickless_max = rtc_lpm35.tickless_max;
+    rtc_slew_applied = rtc_lpm35.slew_applied;
+    #ifdef RTCKIT_DAYSEC
+    {
+        unsigned long sod;
+
+        rtc_day = rtc_div86400(rtcepoch, &sod);
+        rtc_sod = sod;
+        rtc_daysec_epoch = rtcepoch;
     }
-    if (timebuf->tm_yday > 366) {
-        timebuf->tm_yday = 0;
+    #endif
+
+    // Only once per wakeup
+    #ifdef DFWP
+    prot = SYSCFG0 & 0x00FF;
+    SYSCFG0 = FRWPPW | (prot & ~DFWP);
+    #endif
+    rtc_lpm35.magic = 0;
+    #ifdef DFWP
+    SYSCFG0 = FRWPPW | prot;
+    #endif
+    PMMCTL0_H = PMMPW_H;
+    PMMIFG &= ~PMMLPM5IFG;
+    PMMCTL0_H = 0;
+    RTC_HW_IRQ_ON();
+    return 1;
+}
+#endif /* ifdef RTCKIT_LPM35 */
+
+// VLO calibration
+#if defined(RTCKIT_VLO_CALIBRATION) && defined(__MSP430_HAS_T0A3__)
+
+unsigned long rtc_vlo_calibrate(unsigned int ref_source, unsigned long ref_hz, unsigned int counts)
+{
+    unsigned int tassel, cnt, c, n, hi, lo;
+    unsigned long ticks, p0, p1, cps_q16;
+
+    if (rtc_clock != RTC_CLOCK_VLOCLK || rtc_counts_per_sec < 2 || rtc_tick_hz != 1 ||
+        counts == 0) {
+        return 0;
     }
-    if (timebuf->tm_yday == 0 && (timebuf->tm_mday > 0 || timebuf->tm_mon > 0)) {
-        timebuf->tm_yday = rtc_calculate_yday(timebuf, epoch, is_leap);
+    if (counts >= rtc_counts_per_sec) {
+        counts = rtc_counts_per_sec - 1;  // Under a second, so at most one RTC interrupt waits
     }
-    epoch += (unsigned long)timebuf->tm_yday * 86400;
-    epoch += (unsigned long)timebuf->tm_hour * 3600;
-    epoch += (unsigned long)timebuf->tm_min * 60;
-    epoch += timebuf->tm_sec;
-    return epoch;
+    tassel = (ref_source == RTC_CLOCK_SMCLK) ? TASSEL__SMCLK : TASSEL__ACLK;
+
+    // The whole gate runs with interrupts masked: an ISR in the middle of it could hold the loop
+    // off past a second timer overflow, and TAIFG would only count one of them.
+    {
+        RTCKIT_CRITICAL_ENTER();
+
+        // Start Timer0_A3 on an RTC count edge...
+        cnt = rtc_read_cnt();
+        while ((c = rtc_read_cnt()) == cnt)
+            ;
+        TA0CTL = tassel | MC__CONTINUOUS | TACLR;
+        cnt = c;
+        hi = 0;
+
+        // ...count the edges, keeping track of timer overflows, and stop on the last one
+        for (n = counts; n > 0; ) {
+            if (TA0CTL & TAIFG) {
+                TA0CTL &= ~TAIFG;
+                hi++;
+            }
+            c = rtc_read_cnt();
+            if (c != cnt) {
+                cnt = c;
+                n--;
+            }
+        }
+        lo = TA0R;
+        if ((TA0CTL & TAIFG) && lo < 0x8000) {
+            hi++;  // Overflowed just before the read
+        }
+        TA0CTL = MC__STOP;
+        RTCKIT_CRITICAL_EXIT();
+    }
+    ticks = ((unsigned long)hi << 16) | lo;
+    if (ticks == 0) {
+        return 0;
+    }
+
+    // RTC counts per second in Q16: counts / (ticks / ref_hz).  counts * ref_hz << 16 is built
+    // from 16x16 products as two 32-bit halves; a top half of ticks or more would give over
+    // 0xFFFF counts a second, which is out of range anyway.
+    p0 = rtc_mul16(counts, (unsigned int)(ref_hz & 0xFFFF));
+    p1 = rtc_mul16(counts, (unsigned int)(ref_hz >> 16)) + (p0 >> 16);
+    if (p1 >= ticks) {
+        return 0;
+    }
+    cps_q16 = rtc_div64_32(p1, p0 << 16, ticks);
+    if (cps_q16 >> 16 == 0 || cps_q16 >> 16 > 0xFFFE) {
+        return 0;
+    }
+
+    {
+        RTCKIT_CRITICAL_ENTER();
+        rtc_counts_per_sec = (unsigned int)(cps_q16 >> 16);
+        rtc_counts_per_tick = rtc_counts_per_sec;
+        rtc_trim_frac = (unsigned int)(cps_q16 & 0xFFFF);
+        rtc_trim_acc = 0;
+        #ifdef RTCKIT_TICKLESS
+        rtc_tickless_max = 0xFFFF / (rtc_counts_per_sec + 1 + rtc_slew_step);
+        if (rtc_status & RTC_TICKLESS) {
+            // The running period may be many seconds long and was worked out at the old rate -
+            // end it here, crediting the counts so far at the new one.
+            if (!RTC_HW_PENDING()) {
+                cnt = rtc_read_cnt();
+                n = cnt / rtc_counts_per_sec;
+                rtcepoch += n;
+                rtc_tickless_program(cnt - n * rtc_counts_per_sec);
+                rtc_seq++;
+            }
+        } else
+        #endif
+        {
+            // From the next period on; RTC_ISR dithers it from there
+            #if RTC_HW_MOD_BUFFERED
+            RTC_HW_MOD = rtc_counts_per_sec - 1;
+            #else
+            rtc_mod_dirty = 1;  // Written now, it may fall short of the count already reached
+            #endif
+        }
+        RTCKIT_CRITICAL_EXIT();
+    }
+
+    // Undo the prescaler rtc_init_ex() picked
+    return (cps_q16 >> 16) * rtc_prescale_div + (((cps_q16 & 0xFFFF) * rtc_prescale_div + 0x8000) >> 16);
 }
+#endif /* RTCKIT_VLO_CALIBRATION and Timer0_A3 */
+
+// Callbacks
+#ifdef RTCKIT_CALLBACKS
 
+/// Fill in a handler slot - with interrupts masked, since RTC_ISR reads it
+static void rtc_handler_store(volatile struct rtcHandlerEntry *slot, rtcHandler fn, unsigned int flags)
+{
+    RTCKIT_CRITICAL_ENTER();
+    slot->fn = fn;
+    slot->flags = flags;
+    RTCKIT_CRITICAL_EXIT();
+}
 
-unsigned int rtc_calculate_yday(struct tm *timebuf, unsigned long latest_epoch, unsigned int is_leap)
+void rtc_on_tick(rtcHandler fn, unsigned int flags)
 {
-    // latest_epoch has us at the beginning of the latest year
-    unsigned int month = 0, yday = 0;
-    while (month < timebuf->tm_mon) {
-        if (month == 1 && is_leap) {
-            yday += 29;
+    rtc_handler_store(&rtc_tick_handler, fn, flags);
+}
+
+int rtc_on_alarm(unsigned int id, rtcHandler fn, unsigned int flags)
+{
+    volatile struct rtcHandlerEntry *slot;
+
+    if (id == RTC_EVENT_TICK || (slot = rtc_handler_slot(id)) == NULL) {
+        return -1;
+    }
+    rtc_handler_store(slot, fn, flags);
+    return 0;
+}
+
+#endif /* ifdef RTCKIT_CALLBACKS */
+
+#if defined(RTCKIT_CALLBACKS) || RTCKIT_ALARM_TABLE_SIZE > 0
+unsigned int rtc_dispatch(void)
+{
+    unsigned int ran = 0;
+    #ifdef RTCKIT_CALLBACKS
+    unsigned char tail = rtc_pending_tail;
+    unsigned int event;
+    unsigned long epoch;
+    rtcHandler fn;
+    #endif
+
+    // Re-arm first, so a handler of the alarm sees when it triggers next
+    #if RTCKIT_ALARM_TABLE_SIZE > 0
+    rtc_alarm_rearm_run();
+    #endif
+    #ifdef RTCKIT_CALLBACKS
+    while (tail != rtc_pending_head) {
+        event = rtc_pending[tail].event;
+        epoch = rtc_pending[tail].epoch;
+        tail = (tail + 1 == RTCKIT_PENDING_QUEUE_SIZE) ? 0 : tail + 1;
+        rtc_pending_tail = tail;  // Free the entry before the handler runs, so it can't overflow the queue
+
+        fn = rtc_handler_slot(event)->fn;
+        if (fn != NULL) {
+            fn(event, epoch);
+            ran++;
+        }
+    }
+    #endif
+    return ran;
+}
+#endif /* if defined(RTCKIT_CALLBACKS) || RTCKIT_ALARM_TABLE_SIZE > 0 */
+
+// Alarm table
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+
+/// Remove an alarm ID from the sorted queue, if it is there
+static void rtc_alarm_unqueue(unsigned int id)
+{
+    unsigned int i = 0, n = rtc_alarm_queued;
+
+    while (i < n && rtc_alarm_queue[i] != id) {
+        i++;
+    }
+    if (i == n) {
+        return;
+    }
+    n--;
+    for ( ; i < n; i++) {
+        rtc_alarm_queue[i] = rtc_alarm_queue[i+1];
+    }
+    rtc_alarm_queued = n;
+}
+
+/// Insert an alarm ID into the sorted queue behind any alarm due at the same time
+static void rtc_alarm_enqueue(unsigned int id)
+{
+    unsigned long when = rtc_alarms[id].when;
+    unsigned int i = rtc_alarm_queued;
+
+    while (i > 0 && rtc_alarms[rtc_alarm_queue[i-1]].when > when) {
+        rtc_alarm_queue[i] = rtc_alarm_queue[i-1];
+        i--;
+    }
+    rtc_alarm_queue[i] = id;
+    rtc_alarm_queued++;
+}
+
+/// Arm an alarm with either a fixed period or a re-arm function
+static int rtc_alarm_arm(unsigned int id, unsigned long when, unsigned long incr, rtcAlarmRearm fn)
+{
+    if (id >= RTCKIT_ALARM_TABLE_SIZE || when == 0) {
+        return -1;
+    }
+    RTCKIT_CRITICAL_ENTER();
+    rtc_alarm_unqueue(id);
+    rtc_alarms[id].when = when;
+    rtc_alarms[id].incr = incr;
+    rtc_alarm_rearm[id] = fn;
+    rtc_alarm_rearm_due &= ~(1U << id);
+    rtc_alarm_enqueue(id);
+    RTCKIT_CRITICAL_EXIT();
+    #ifdef RTCKIT_TICKLESS
+    rtc_tickless_update();
+    #endif
+    return 0;
+}
+
+int rtc_alarm_set(unsigned int id, unsigned long when, unsigned long incr)
+{
+    return rtc_alarm_arm(id, when, incr, NULL);
+}
+
+int rtc_alarm_set_rearm(unsigned int id, unsigned long when, rtcAlarmRearm fn)
+{
+    return rtc_alarm_arm(id, when, 0, fn);
+}
+
+void rtc_alarm_cancel(unsigned int id)
+{
+    if (id >= RTCKIT_ALARM_TABLE_SIZE) {
+        return;
+    }
+    RTCKIT_CRITICAL_ENTER();
+    rtc_alarm_unqueue(id);
+    rtc_alarms[id].when = 0;
+    rtc_alarm_rearm[id] = NULL;
+    rtc_alarm_rearm_due &= ~(1U << id);
+    rtc_alarm_triggered &= ~(1U << id);
+    RTCKIT_CRITICAL_EXIT();
+}
+
+int rtc_alarm_set_in(unsigned int id, unsigned long secs, unsigned long incr)
+{
+    return rtc_alarm_set(id, rtc_get_epoch() + secs, incr);
+}
+
+unsigned long rtc_alarm_get(unsigned int id)
+{
+    unsigned long when;
+    unsigned int seq;
+
+    if (id >= RTCKIT_ALARM_TABLE_SIZE) {
+        return 0;
+    }
+    do {
+        seq = rtc_seq;
+        when = rtc_alarms[id].when;
+    } while (seq != rtc_seq);
+    return when;
+}
+
+unsigned long rtc_alarm_next(void)
+{
+    unsigned long when;
+    unsigned int seq;
+
+    do {
+        seq = rtc_seq;
+        when = 0;
+        if (rtc_alarm_queued > 0) {
+            when = rtc_alarms[rtc_alarm_queue[0]].when;
+        }
+    } while (seq != rtc_seq);
+    return when;
+}
+
+/** Fire every alarm at the head of the queue that is due, re-arming periodic ones.
+ *  The due alarms all come off the queue before any is re-armed, so each fires no more than
+ *  once per call - a RTC_ALARM_CATCHUP alarm that is still behind can't hold up the others.
+ *  An alarm with a re-arm function is left for rtc_dispatch() to re-arm, off the queue.
+ *  Returns nonzero if any fired.
+ */
+int rtc_alarm_service(unsigned long now)
+{
+    unsigned char due[RTCKIT_ALARM_TABLE_SIZE];
+    unsigned int i, id, n = 0;
+
+    while (rtc_alarm_queued > 0 && now >= rtc_alarms[rtc_alarm_queue[0]].when) {
+        id = due[n++] = rtc_alarm_queue[0];
+        rtc_alarm_unqueue(id);
+        rtc_alarm_triggered |= 1U << id;
+        RTCKIT_STAT_INC(alarms_fired);
+        if (now > rtc_alarms[id].when) {
+            RTCKIT_STAT_INC(alarms_missed);
+        }
+        #ifdef RTCKIT_CALLBACKS
+        rtc_event(id, now);
+        #endif
+    }
+    for (i = 0; i < n; i++) {
+        id = due[i];
+        if (rtc_alarms[id].incr > 0) {
+            rtc_alarms[id].when = rtc_alarm_advance(rtc_alarms[id].when, rtc_alarms[id].incr, now,
+                                                    &rtc_alarm_state[id]);
+            rtc_alarm_enqueue(id);
+        } else if (rtc_alarm_rearm[id] != NULL) {
+            rtc_alarms[id].when = now;
+            rtc_alarm_rearm_from[id] = now;
+            rtc_alarm_rearm_due |= 1U << id;
         } else {
-            yday += monthInfo[month].days;
+            rtc_alarms[id].when = 0;
+            rtc_alarm_rearm[id] = NULL;
+        }
+    }
+    if (n > 0) {
+        rtc_status |= RTCALARM_TABLE_TRIGGERED;
+    }
+    return n > 0;
+}
+
+static void rtc_alarm_reevaluate(unsigned long epoch)
+{
+    unsigned char ids[RTCKIT_ALARM_TABLE_SIZE];
+    unsigned int i, id, n = rtc_alarm_queued;
+
+    for (i = 0; i < n; i++) {
+        id = ids[i] = rtc_alarm_queue[i];
+        if (rtc_alarms[id].incr > 0) {
+            rtc_alarms[id].when = rtc_alarm_realign(rtc_alarms[id].when, rtc_alarms[id].incr, epoch,
+                                                    &rtc_alarm_state[id]);
+        } else if (rtc_alarm_rearm[id] != NULL && rtc_alarms[id].when > epoch) {
+            // Stepped back - the rule may match sooner now.  It stays queued for the match it
+            // has until rtc_dispatch() has worked the new one out.
+            rtc_alarm_rearm_from[id] = epoch;
+            rtc_alarm_rearm_due |= 1U << id;
+        }
+    }
+    // Re-sort in one go
+    rtc_alarm_queued = 0;
+    for (i = 0; i < n; i++) {
+        rtc_alarm_enqueue(ids[i]);
+    }
+    // Those that fired and wait for rtc_dispatch() look for a match from the new time too
+    for (id = 0; id < RTCKIT_ALARM_TABLE_SIZE; id++) {
+        if ((rtc_alarm_rearm_due & (1U << id)) && rtc_alarm_rearm_from[id] > epoch) {
+            rtc_alarm_rearm_from[id] = epoch;
+        }
+    }
+}
+
+/// Run the re-arm functions RTC_ISR left to rtc_dispatch(), and queue their alarms again
+static void rtc_alarm_rearm_run(void)
+{
+    unsigned int id, armed = 0;
+    unsigned long from, next;
+    rtcAlarmRearm fn;
+
+    for (id = 0; id < RTCKIT_ALARM_TABLE_SIZE; id++) {
+        while (rtc_alarm_rearm_due & (1U << id)) {
+            {
+                RTCKIT_CRITICAL_ENTER();
+                fn = rtc_alarm_rearm[id];
+                from = rtc_alarm_rearm_from[id];
+                RTCKIT_CRITICAL_EXIT();
+            }
+            next = (fn != NULL) ? fn(id, from) : 0;
+            {
+                RTCKIT_CRITICAL_ENTER();
+                // Set, cancelled, fired or stepped meanwhile, the alarm is left as it is - or
+                // goes round again
+                if ((rtc_alarm_rearm_due & (1U << id)) && rtc_alarm_rearm[id] == fn &&
+                    rtc_alarm_rearm_from[id] == from) {
+                    rtc_alarm_rearm_due &= ~(1U << id);
+                    if (next > from) {
+                        rtc_alarm_unqueue(id);
+                        rtc_alarms[id].when = next;
+                        rtc_alarm_enqueue(id);
+                        armed = 1;
+                    } else if (rtc_alarms[id].when <= from) {
+                        // Fired, and the rule matches no more
+                        rtc_alarms[id].when = 0;
+                        rtc_alarm_rearm[id] = NULL;
+                    }
+                }
+                RTCKIT_CRITICAL_EXIT();
+            }
         }
-        month++;
     }
-    if (timebuf->tm_mday > 0) {
-        yday += timebuf->tm_mday - 1;  // tm_mday starts at 1
+    #ifdef RTCKIT_TICKLESS
+    if (armed) {
+        rtc_tickless_update();
     }
+    #else
+    (void)armed;
+    #endif
+}
+#endif /* if RTCKIT_ALARM_TABLE_SIZE > 0 */
+
+// Runtime statistics
+#ifdef RTCKIT_STATS
+
+void rtc_stats(struct rtcStats *stats, unsigned int reset)
+{
+    {
+        RTCKIT_CRITICAL_ENTER();
+        stats->isr_entries = rtc_st.isr_entries;
+        stats->wakeups = rtc_st.wakeups;
+        stats->alarms_fired = rtc_st.alarms_fired;
+        stats->alarms_missed = rtc_st.alarms_missed;
+        stats->isr_cycles_max = rtc_st.isr_cycles_max;
+        if (reset) {
+            rtc_st.isr_entries = 0;
+            rtc_st.wakeups = 0;
+            rtc_st.alarms_fired = 0;
+            rtc_st.alarms_missed = 0;
+            rtc_st.isr_cycles_max = 0;
+        }
+        RTCKIT_CRITICAL_EXIT();
+    }
+    stats->checkpoint_age = 0;
+    #ifdef RTCKIT_CHECKPOINT_INTERVAL
+    stats->checkpoint_age = rtc_get_epoch() - rtc_ckpt.epoch;
+    #endif
+    rtc_cache_stats(&stats->cache, reset);
+}
+#endif /* ifdef RTCKIT_STATS */
+
+// RTC hardware ISR, from the steps in rtckit_isr.h - or put together by RTCKIT_ISR() instead
+#ifdef RTCKIT_LIBRARY_PROVIDES_ISR
+
+#if defined(RTC_HW_VECTOR)
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector=RTC_HW_VECTOR
+__interrupt void RTC_ISR(void)
+#elif defined(__GNUC__) && defined(__MSP430__)
+void __attribute__ ((interrupt(RTC_HW_VECTOR))) RTC_ISR (void)
+#elif defined(RTCKIT_HOST_STUB)
+void RTC_ISR(void)  // Host build against test/msp430.h - the tests raise the interrupt themselves
+#else
+#error Compiler not supported!
+#endif
+{
+    unsigned int flags = rtc_step_begin();
+
+    if (flags & RTC_ISR_CONTINUE) {
+        #ifdef RTCKIT_DAYSEC
+        rtc_step_daysec();
+        #endif
+        #ifdef RTCKIT_CALLBACKS
+        flags |= rtc_step_tick_handler();
+        #endif
+        #ifdef RTCKIT_LEGACY_ALARMS
+        flags |= rtc_step_legacy_alarms();
+        #endif
+        #if RTCKIT_ALARM_TABLE_SIZE > 0
+        flags |= rtc_step_alarm_table();
+        #endif
+        #ifdef RTCKIT_CHECKPOINT_INTERVAL
+        rtc_step_checkpoint();
+        #endif
+        flags = rtc_step_end(flags);
+    }
+    if (flags & RTC_ISR_WAKEUP) {
+        __bic_SR_register_on_exit(LPM3_bits);
+    }
+}
+#endif /* if defined RTC_HW_VECTOR */
+#endif /* ifdef RTC_LIBRARY_PROVIDES_ISR */
 
-    return yday;
+
+// Current time, on top of the conversion code in rtckit_conv.c
+
+#if RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+struct rtc_datetime * rtc_now_dt(struct rtc_datetime *dt)
+{
+    rtc_calendar_read(dt);
+    return dt;
+}
+#elif defined(RTCKIT_DAYSEC)
+struct rtc_datetime * rtc_now_dt(struct rtc_datetime *dt)
+{
+    unsigned int day;
+    unsigned long sod = rtc_now_daysec(&day);
+
+    rtc_interpret_days(day, sod, dt);
+    return dt;
+}
+#endif
+
+/// Broken-down time maintained by rtc_now_tm(), and the epoch it currently represents
+static struct tm nowbuf;
+#if RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+struct tm * rtc_now_tm(void)
+{
+    struct rtc_datetime dt;
+
+    rtc_calendar_read(&dt);
+    nowbuf.tm_sec = dt.sec;
+    nowbuf.tm_min = dt.min;
+    nowbuf.tm_hour = dt.hour;
+    nowbuf.tm_mday = dt.mday;
+    nowbuf.tm_mon = dt.mon;
+    nowbuf.tm_year = dt.year;
+    nowbuf.tm_wday = dt.wday;
+    nowbuf.tm_yday = dt.yday;
+    nowbuf.tm_isdst = 0;
+    return (&nowbuf);
+}
+#else
+static unsigned long nowbuf_epoch;
+
+struct tm * rtc_now_tm(void)
+{
+    unsigned long now = rtc_get_epoch();
+    unsigned long delta = now - nowbuf_epoch;
+    unsigned int leap;
+    int mdays;
+
+    if (nowbuf_epoch == 0 || now < nowbuf_epoch || delta >= 60) {
+        // First call, rtcepoch was written by user code, or we haven't been called in a while
+        rtc_interpret_r(now, &nowbuf);
+        nowbuf_epoch = now;
+        return (&nowbuf);
+    }
+    nowbuf_epoch = now;
+
+    // Carry sec -> min -> hour -> day -> month -> year
+    nowbuf.tm_sec += (unsigned int)delta;
+    if (nowbuf.tm_sec < 60) {
+        return (&nowbuf);
+    }
+    nowbuf.tm_sec -= 60;
+    if (++nowbuf.tm_min < 60) {
+        return (&nowbuf);
+    }
+    nowbuf.tm_min = 0;
+    if (++nowbuf.tm_hour < 24) {
+        return (&nowbuf);
+    }
+    nowbuf.tm_hour = 0;
+    if (++nowbuf.tm_wday == 7) {
+        nowbuf.tm_wday = 0;
+    }
+    nowbuf.tm_yday++;
+    leap = rtc_is_leap(nowbuf.tm_year);
+    mdays = rtc_yday_before_month[leap][nowbuf.tm_mon+1] - rtc_yday_before_month[leap][nowbuf.tm_mon];
+    if (++nowbuf.tm_mday > mdays) {
+        nowbuf.tm_mday = 1;
+        if (++nowbuf.tm_mon == 12) {
+            nowbuf.tm_mon = 0;
+            nowbuf.tm_yday = 0;
+            nowbuf.tm_year++;
+        }
+    }
+    return (&nowbuf);
 }
+#endif /* if RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C */
@@ -40,11 +40,68 @@
 #define RTCKIT_H
 #include <time.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Timebases rtc_init() and RTC_ISR can run on - see RTCKIT_BACKEND
+#define RTCKIT_BACKEND_RTC      0
+#define RTCKIT_BACKEND_TIMER_A  1
+#define RTCKIT_BACKEND_WDT      2
+#define RTCKIT_BACKEND_RTC_C    3
+
 /// User configuration YOU MAY MODIFY THESE
 
+/// Comment out to put RTC_ISR together in C++ instead, from the features listed to rtckit.hpp
 #define RTCKIT_LIBRARY_PROVIDES_ISR 1
 #define RTCKIT_STORE_VARIABLES_IN_SECTION ".infoA"
 
+/** The timebase:
+ *  RTCKIT_BACKEND_RTC     - the RTC counter of the FR4xxx/FR2xxx parts
+ *  RTCKIT_BACKEND_TIMER_A - Timer_A number RTCKIT_TIMER_A (default 1) in up mode, on ACLK or SMCLK
+ *  RTCKIT_BACKEND_WDT     - the watchdog's interval timer, on ACLK or the VLO - not SMCLK
+ *  RTCKIT_BACKEND_RTC_C   - the RTC_C calendar of the FR5xxx/FR6xxx parts, on XT1
+ *  The WDT and RTC_C have no period to program, so RTCKIT_TICKLESS and RTCKIT_VLO_CALIBRATION
+ *  must be left undefined with them; RTCKIT_LPM35 needs the RTC.
+ */
+#define RTCKIT_BACKEND RTCKIT_BACKEND_RTC
+// #define RTCKIT_TIMER_A 1
+
+/// Number of entries in the alarm table (rtc_alarm_set() et al), up to 16; 0 leaves it out
+#define RTCKIT_ALARM_TABLE_SIZE 8
+/// Compile in tickless mode - see RTC_INIT_TICKLESS
+#define RTCKIT_TICKLESS 1
+/// Drive the MPY32 hardware multiplier directly in the conversion code, on parts that have one
+#define RTCKIT_USE_MPY32 1
+/// Keep the two original alarms - rtcalarm0/rtcalarm1 - alongside the alarm table
+#define RTCKIT_LEGACY_ALARMS 1
+/// Have RTC_ISR keep the time as a day number and second-of-day too - see rtc_now_dt()
+// #define RTCKIT_DAYSEC 1
+/// Compile in handler callbacks (rtc_on_tick() et al), and how many events may await rtc_dispatch()
+#define RTCKIT_CALLBACKS 1
+#define RTCKIT_PENDING_QUEUE_SIZE 8
+/// Compile in rtc_vlo_calibrate() - measures the VLO against SMCLK or XT1 using Timer0_A3
+// #define RTCKIT_VLO_CALIBRATION 1
+
+/** Compile in rtc_stats() - counts of what RTC_ISR does, for working out where the energy goes.
+ *  With RTCKIT_STATS_TIMER too, RTC_ISR reads that free-running timer on entry and exit and keeps
+ *  the longest run; set the timer up on MCLK in continuous mode to get cycles.  Left undefined,
+ *  none of it is compiled in.
+ */
+// #define RTCKIT_STATS 1
+// #define RTCKIT_STATS_TIMER TA1R
+
+/** Keep rtcepoch and the alarms in SRAM, and copy them to RTCKIT_STORE_VARIABLES_IN_SECTION
+ *  only every this many seconds (and on rtc_checkpoint()) instead of writing FRAM every tick.
+ *  Leave undefined to keep them in RTCKIT_STORE_VARIABLES_IN_SECTION directly.
+ */
+// #define RTCKIT_CHECKPOINT_INTERVAL 3600UL
+
+/** Compile in rtc_shutdown()/rtc_resume() - LPM3.5 between RTC events, on parts whose RTC keeps
+ *  counting there.  Needs RTCKIT_TICKLESS.
+ */
+// #define RTCKIT_LPM35 1
+
 /// End of User configuration
 
 
@@ -61,31 +118,91 @@
 /// for every 1-second tick, clearing this avoids that (unless an alarm triggers)
 #define RTC_TICK_DOES_WAKEUP 0x0100
 
+/// RTC_SUBTICK bitfield inside rtc_status indicates RTC_ISR has fired for a tick inside the
+/// second - only with a tick rate above 1Hz, see rtc_init_ex()
+#define RTC_SUBTICK 0x0040
+
+/// User setting RTC_SUBTICK_DOES_WAKEUP tells the ISR to wake up the chip for those ticks too
+#define RTC_SUBTICK_DOES_WAKEUP 0x0400
+
+/// RTC_TICKLESS bitfield inside rtc_status indicates rtc_init() started tickless mode
+#define RTC_TICKLESS 0x0200
+
+/// RTC_EPOCH_RESTORED bitfield inside rtc_status indicates rtc_init() restored rtcepoch and the
+/// alarms from the FRAM checkpoint - see rtc_checkpoint_uncertainty()
+#define RTC_EPOCH_RESTORED 0x0010
+
+/// RTC_LPM35_RESUMED bitfield inside rtc_status indicates rtc_init() picked the RTC up where
+/// rtc_shutdown() left it, after an LPM3.5 wakeup
+#define RTC_LPM35_RESUMED 0x0080
+
+/// RTC_DISPATCH_OVERFLOW bitfield inside rtc_status indicates an event was dropped because
+/// rtc_dispatch() fell RTCKIT_PENDING_QUEUE_SIZE events behind
+#define RTC_DISPATCH_OVERFLOW 0x0020
+
 /// RTCALARM_0_TRIGGERED bitfield inside rtc_status indicates Alarm#0 has triggered
 #define RTCALARM_0_TRIGGERED 0x0002
 /// RTCALARM_1_TRIGGERED bitfield inside rtc_status indicates Alarm#1 has triggered
 #define RTCALARM_1_TRIGGERED 0x0004
+/// RTCALARM_TABLE_TRIGGERED bitfield inside rtc_status indicates an alarm table entry
+/// has triggered - see rtc_alarm_triggered for which one(s)
+#define RTCALARM_TABLE_TRIGGERED 0x0008
 /// rtc_status is a user-testable variable - see rtckit.h for bitfields
 extern volatile unsigned int rtc_status;
 
 extern volatile unsigned long rtcepoch;  ///< The current timestamp; RTC_ISR increments this.
+
+#ifdef RTCKIT_DAYSEC
+/** rtcepoch split into days since Jan 1 1970 and seconds into that day, carried forward by
+ *  RTC_ISR alongside rtcepoch.  Read them through rtc_now_daysec(), which also copes with
+ *  rtcepoch having been written since the last tick.
+ */
+extern volatile unsigned int rtc_day;
+extern volatile unsigned long rtc_sod;
+#endif
+
+#ifdef RTCKIT_LEGACY_ALARMS
 /// The epoch timestamp at which Alarm#0 will trigger.  0 disables this alarm.
 extern volatile unsigned long rtcalarm0;
 /// The epoch timestamp at which Alarm#1 will trigger.  0 disables this alarm.
 extern volatile unsigned long rtcalarm1;
 
-/** If rtcalarm0 is reached, rtc_status will reflect RTCALARM_0_TRIGGERED and
+/** If rtcalarm0 is reached or passed, rtc_status will reflect RTCALARM_0_TRIGGERED and
  *  if this variable's value is > 0, rtcalarm0 will automatically increment by this
- *  amount inside RTC_ISR so re-setting the alarm after each trigger is not necessary.
+ *  amount inside RTC_ISR so re-setting the alarm after each trigger is not necessary -
+ *  see rtc_alarm_policy() for what happens when more than one increment has passed.
+ *  Otherwise the alarm is one-shot, and RTC_ISR sets rtcalarm0 back to 0.
  */
 extern volatile unsigned long rtcalarm0_incr;
 
-/** If rtcalarm1 is reached, rtc_status will reflect RTCALARM_1_TRIGGERED and
- *  if this variable's value is > 0, rtcalarm1 will automatically increment by this
- *  amount inside RTC_ISR so re-setting the alarm after each trigger is not necessary.
+/** If rtcalarm1 is reached or passed, rtc_status will reflect RTCALARM_1_TRIGGERED - the same
+ *  as rtcalarm0_incr.
  */
 extern volatile unsigned long rtcalarm1_incr;
 
+/// IDs standing for rtcalarm0/rtcalarm1 in rtc_alarm_policy() and the callbacks
+#define RTC_EVENT_ALARM0 0x80
+#define RTC_EVENT_ALARM1 0x81
+#endif /* ifdef RTCKIT_LEGACY_ALARMS */
+
+#if RTCKIT_ALARM_TABLE_SIZE > 16
+#error RTCKIT_ALARM_TABLE_SIZE may not exceed 16 - rtc_alarm_triggered holds one bit per alarm
+#endif
+
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+/** Bit (1U << id) is set inside RTC_ISR when alarm table entry "id" triggers, along with
+ *  RTCALARM_TABLE_TRIGGERED in rtc_status.  Your code should clear the bits it has handled.
+ */
+extern volatile unsigned int rtc_alarm_triggered;
+
+/// An alarm table entry
+struct rtcAlarm
+{
+    unsigned long when;    /* Epoch timestamp at which the alarm triggers, 0 = unused    */
+    unsigned long incr;    /* Re-arm by this many seconds after triggering, 0 = one-shot */
+};
+#endif
+
 
 /// Data structure indicating day-of-week indices, shortnames and long names
 struct rtcDayInfo
@@ -102,12 +219,36 @@ struct rtcMonthInfo
     char    longName[10];
 };
 
-/// A predefined instance of s_MonthInfo for general use
+/** Compact broken-down time - the fields mean the same as their struct tm namesakes,
+ *  except year holds the full year (as tm_year does throughout this library).
+ *  10 bytes against the 18 of a struct tm on MSP430.
+ */
+struct rtc_datetime
+{
+    unsigned int year;       /* Full year, 1970-2106                 */
+    unsigned int yday;       /* days since Jan 1st         - [0,365] */
+    unsigned char mon;       /* months since January       - [0,11]  */
+    unsigned char mday;      /* day of the month           - [1,31]  */
+    unsigned char hour;      /* hours after the midnight   - [0,23]  */
+    unsigned char min;       /* minutes after the hour     - [0,59]  */
+    unsigned char sec;       /* seconds after the minute   - [0,59]  */
+    unsigned char wday;      /* days since Sunday          - [0,6]   */
+};
+
+/** A predefined instance of s_MonthInfo for general use
+ *  The name tables live in rtckit_names.c - leave that file out of the build if nothing
+ *  prints names, and the conversions won't pull them in.
+ */
 extern const struct rtcMonthInfo monthInfo[];
 
 /// A predefined instance of s_DayInfo for general use
 extern const struct rtcDayInfo dayInfo[];
 
+/** Days elapsed before the start of each month - row 0 for common years, row 1 for leap years.
+ *  [leap][12] is the length of the year, and [leap][m+1] - [leap][m] the length of month m.
+ */
+extern const unsigned int rtc_yday_before_month[2][13];
+
 /** User functions
  */
 
@@ -115,14 +256,414 @@ extern const struct rtcDayInfo dayInfo[];
  *
  *  @param[in] A parameter (see below) corresponding to which clock source
  *             is to be used for the RTC peripheral.
+ *
+ *  With RTCKIT_LPM35, on a wakeup from rtc_shutdown() this and rtc_init_ex()/rtc_init_preset()
+ *  carry on with the setting the RTC was shut down with - it is left running - and set
+ *  RTC_LPM35_RESUMED.
+ *  On the RTC_C backend, a calendar still running from before the reset - anything short of a
+ *  BOR - sets rtcepoch, rather than the other way round.
  */
 void rtc_init(unsigned int rtc_clock_source);
 
+#if RTCKIT_BACKEND == RTCKIT_BACKEND_TIMER_A
+#define RTC_CLOCK_XT1CLK    TASSEL__ACLK               /* ACLK, which must be running from XT1     */
+#define RTC_CLOCK_SMCLK     TASSEL__SMCLK
+#define RTC_CLOCK_VLOCLK    (TASSEL__ACLK | 0x0400)    /* ACLK, which must be running from the VLO */
+#elif RTCKIT_BACKEND == RTCKIT_BACKEND_WDT
+// No RTC_CLOCK_SMCLK: at MHz rates even the longest interval, 32768 cycles, ticks too often
+#define RTC_CLOCK_XT1CLK    WDTSSEL__ACLK              /* ACLK, which must be running from XT1     */
+#define RTC_CLOCK_VLOCLK    WDTSSEL__VLO
+#elif RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+#define RTC_CLOCK_XT1CLK    0x0000                     /* The calendar only runs from XT1/LFXT      */
+#else
 #define RTC_CLOCK_XT1CLK    RTCSS__XT1CLK
 #define RTC_CLOCK_SMCLK     RTCSS__SMCLK
 #define RTC_CLOCK_VLOCLK    RTCSS__VLOCLK
+#endif
+
+/** Initialize MSP430 RTC peripheral for a given source frequency and tick rate
+ *  Every RTCPS prescaler is tried with the nearest RTCMOD, and the pair that comes closest to
+ *  tick_hz is used - at equal error, the larger prescaler, so long as that leaves 100 or more
+ *  counts per tick.  rtc_init(source) is rtc_init_ex(source, 0, 1, NULL).
+ *  Above 1Hz, RTC_ISR counts the ticks within each second and only advances rtcepoch - and
+ *  checks the alarms - on the last one; the rest set RTC_SUBTICK.  rtc_now_ticks() and
+ *  friends still count from the start of the second.  Tickless mode needs a 1Hz tick.
+ *  The WDT backend has no modulo to pick: it takes the longest interval that interrupts at
+ *  least tick_hz times a second, and rtc_ticks_per_second() is the source frequency.  The
+ *  RTC_C backend only runs at 1Hz from XT1.
+ *
+ *  @param[in] Clock source, as for rtc_init() - RTC_INIT_TICKLESS may be ORed in
+ *  @param[in] Frequency of the source in Hz, 0 for the nominal 32768Hz/10kHz or the SMCLK guess
+ *  @param[in] Ticks per second, 1 to 1024
+ *  @param[in] Pointer receiving the rate error of the chosen setting in ppm, positive if the
+ *             ticks come too fast (may be NULL)
+ *  @param[out] 0 on success, -1 if no setting fits - RTC_GENERAL_ERROR is set as well
+ */
+int rtc_init_ex(unsigned int rtc_clock_source, unsigned long source_hz, unsigned int tick_hz,
+                long *error_ppm);
+
+/** Initialize MSP430 RTC peripheral with a prescaler and modulo worked out beforehand
+ *  What rtc_init_ex() ends with, for settings known at build time - see rtckit.hpp.  Nothing
+ *  is chosen at run time, so a build that only calls this leaves the search and the SMCLK
+ *  guess out.
+ *
+ *  @param[in] Clock source, as for rtc_init() - RTC_INIT_TICKLESS may be ORed in
+ *  @param[in] Prescaler divider - RTCPS: 1, 10, 16, 64, 100, 256, 1000 or 1024; Timer_A ID and
+ *             IDEX: 1, 2, 4, 8, 16, 32 or 64; WDT: the interval, 64, 512, 8192 or 32768; RTC_C: 1
+ *  @param[in] RTC counts per tick, 2 or more - WDT: the source frequency; RTC_C: 32768
+ *  @param[in] Ticks per second, 1 to 1024 - 1 for tickless mode
+ *  @param[out] 0 on success, -1 if the setting is invalid - RTC_GENERAL_ERROR is set as well
+ */
+int rtc_init_preset(unsigned int rtc_clock_source, unsigned int prescaler, unsigned int counts,
+                    unsigned int tick_hz);
+
+/** OR this into the rtc_init() clock source for tickless mode (requires RTCKIT_TICKLESS):
+ *  rather than interrupting every second, the RTC counter is programmed to run straight to
+ *  the next alarm - or as far as RTCMOD allows - and rtcepoch is advanced by the whole gap at once.
+ */
+#define RTC_INIT_TICKLESS   0x0001
+
+/// A consistent view of the RTC state, taken by rtc_snapshot()
+struct rtcSnapshot
+{
+    unsigned long epoch;     /* The current timestamp                                  */
+    unsigned int ticks;      /* RTC counts into the current second                     */
+    unsigned int status;     /* rtc_status as RTC_ISR last left it                     */
+};
+
+/** Read the epoch, sub-second count and rtc_status together, as of a single instant
+ *  rtcepoch is 32 bits wide, so a plain read from the main loop can tear when RTC_ISR updates it
+ *  between the two word loads.  This retries the reads whenever RTC_ISR ran in the middle
+ *  of them - instead of masking interrupts - so it adds no latency to other ISRs.
+ *
+ * @param[in] Pointer to the struct rtcSnapshot to fill
+ */
+void rtc_snapshot(struct rtcSnapshot *snap);
+
+/** Read the current epoch
+ *  Use this rather than reading rtcepoch directly: it can't tear (see rtc_snapshot()), and in
+ *  tickless mode - where rtcepoch is only brought up to date when RTC_ISR runs - it adds the
+ *  seconds counted by RTCCNT since then.
+ *
+ * @param[out] The current timestamp in epoch format
+ */
+unsigned long rtc_get_epoch(void);
+
+/** Read the current epoch along with the RTC counts elapsed in the current second
+ *  Safe against the counter rolling over during the read, even with interrupts disabled; the
+ *  reads are the same as rtc_snapshot().
+ *
+ * @param[in] Pointer receiving the counts into the current second, 0 to rtc_ticks_per_second()-1
+ *            (may be NULL)
+ * @param[out] The current timestamp in epoch format
+ */
+unsigned long rtc_now_ticks(unsigned int *ticks);
+
+/** Read the current epoch along with the milliseconds elapsed in the current second
+ *  Resolution is one RTC count - 1/128 second with XT1CLK, 1/100 second with VLOCLK.
+ *
+ * @param[in] Pointer receiving the milliseconds into the current second, 0-999
+ * @param[out] The current timestamp in epoch format
+ */
+unsigned long rtc_now_ms(unsigned int *ms);
+
+/** Read the current time as a 32.16 fixed-point timestamp
+ *
+ * @param[in] Pointer receiving the fraction of the current second, in 1/65536ths
+ * @param[out] The current timestamp in epoch format - the integer part
+ */
+unsigned long rtc_now_frac(unsigned int *frac);
+
+#ifdef RTCKIT_VLO_CALIBRATION
+/** Measure the VLO against an accurate clock and trim the RTC to it
+ *  The VLO is only nominally 10kHz.  With the RTC already running from it - rtc_init(RTC_CLOCK_VLOCLK) -
+ *  this times a number of RTC counts with Timer0_A3 clocked from the reference, then corrects the
+ *  counts per second to the measured rate.  The fractional part is applied by a Q16 accumulator
+ *  that lengthens a period by one count whenever it carries, so over time RTCMOD dithers between
+ *  two values and the average rate follows the measurement to well within the VLO's own drift.
+ *  The RTC keeps counting throughout, but interrupts are masked for the whole measurement, so it
+ *  is kept under a second: an RTC tick falling inside it is taken late rather than lost, and
+ *  other interrupts wait up to that long.  Call it again every so often to follow temperature
+ *  drift - rtc_init() resets the trim.
+ *
+ * @param[in] RTC_CLOCK_SMCLK, or RTC_CLOCK_XT1CLK for ACLK - which must be running from XT1
+ * @param[in] Frequency of the reference in Hz
+ * @param[in] RTC counts to measure over, up to one less than the counts in a second - 99 with
+ *             the default prescaler; more counts, finer trim
+ * @param[out] The measured VLO frequency in Hz, 0 if the RTC isn't running from the VLO
+ */
+unsigned long rtc_vlo_calibrate(unsigned int ref_source, unsigned long ref_hz, unsigned int counts);
+#endif
+
+/** Set the current time
+ *  Preferred over writing rtcepoch directly: the update can't tear, and everything derived
+ *  from the time - the day/second-of-day pair, tickless mode's next wakeup, the RTC_C
+ *  calendar - follows at once.
+ *  The alarms are re-evaluated in the same pass: those stepped over trigger on the next tick,
+ *  RTC_ALARM_REALIGN ones only once, and periodic ones stepped back from keep their phase but
+ *  come no more than one period ahead.  RTCCNT is not touched, so the fraction of the current
+ *  second carries on.
+ *
+ * @param[in] The new timestamp in epoch format
+ */
+void rtc_set_epoch(unsigned long epoch);
+
+/** Set the current time to a fraction of a second
+ *  For a GPS PPS edge or a network time reply: the RTC counter is restarted so the next second
+ *  begins exactly subsec counts from now, instead of whenever RTCCNT's old phase says.  The
+ *  alarms are re-evaluated as by rtc_set_epoch(), and any rtc_adjtime() slew is dropped.
+ *
+ * @param[in] The new timestamp in epoch format
+ * @param[in] RTC counts already elapsed in that second, as from rtc_now_ticks() - 0 on a PPS edge
+ * @param[out] 0 on success, -1 if the RTC isn't running or subsec is a second or more
+ */
+int rtc_set_time_precise(unsigned long epoch, unsigned int subsec);
+
+/** Correct the time gradually instead of stepping it
+ *  Like adjtime(), the seconds are made slightly shorter (delta_ms > 0) or longer until the
+ *  correction has been applied: RTCMOD of the last tick of each second - or of each tickless
+ *  period - is changed by up to about 500ppm, or one count a second if that is more.  rtcepoch never jumps, the alarms keep their
+ *  cadence, and no extra wakeups are needed; a correction of 1 second takes some 35 minutes.
+ *  The WDT backend moves its cycle count by as much once a second; RTC_C does nothing.
+ *
+ * @param[in] Milliseconds to move the clock forward by, negative to hold it back - this replaces
+ *            any correction still in progress, 0 cancels it; beyond 32767 seconds either way
+ *            it is clamped to that
+ * @param[out] Milliseconds of the previous correction that were still left
+ */
+long rtc_adjtime(long delta_ms);
+
+#ifdef RTCKIT_DAYSEC
+/** Read the current time as a day number and second-of-day
+ *
+ * @param[in] Pointer receiving the days since Jan 1 1970
+ * @param[out] Seconds into that day, 0-86399
+ */
+unsigned long rtc_now_daysec(unsigned int *day);
+#endif
+
+#if defined(RTCKIT_DAYSEC) || RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+/** Read the current time as a struct rtc_datetime, straight from the day/second-of-day pair
+ *  No 32-bit epoch is reduced to get there, so it's the cheapest way to the current date.
+ *  On the RTC_C backend the fields are read from the hardware calendar instead.
+ *
+ * @param[in] Pointer to the struct rtc_datetime buffer to fill
+ * @param[out] The same buffer pointer
+ */
+struct rtc_datetime * rtc_now_dt(struct rtc_datetime *dt);
+#endif
+
+/** Report the RTC counter rate set up by rtc_init()
+ *  With a tick rate above 1Hz this covers all the ticks of a second.
+ *
+ * @param[out] RTC counts per second - the unit of rtc_now_ticks()
+ */
+unsigned int rtc_ticks_per_second(void);
+
+#ifdef RTCKIT_TICKLESS
+/** Tell tickless mode that rtcalarm0/rtcalarm1 or RTC_TICK_DOES_WAKEUP have changed
+ *  If the RTC counter is set to run past the new next event, it is restarted to end there
+ *  instead.  rtc_alarm_set() does this by itself.  Does nothing outside tickless mode.
+ */
+void rtc_tickless_update(void);
+
+#ifdef RTCKIT_LPM35
+/** Called by rtc_resume() straight out of the LPM3.5 wakeup reset, before the C runtime has
+ *  initialized SRAM - it may only use registers, FRAM and its stack.
+ *
+ * @param[in] The alarm due - an alarm table ID or RTC_EVENT_ALARM0/1 - or RTC_EVENT_WAKE
+ * @param[in] The current time
+ */
+typedef void (*rtcWakeHandler)(unsigned int event, unsigned long epoch);
+
+/// Event passed to a wake handler when no alarm is due - the wakeup came from elsewhere
+#define RTC_EVENT_WAKE   0xFE
+
+/** Shut down into LPM3.5 until the next RTC event
+ *  In tickless mode the RTC counter already runs to the next alarm, so all this does is save
+ *  what RTC_ISR keeps in SRAM - the status, the running period and its sub-second phase, the
+ *  trim - to RTCKIT_STORE_VARIABLES_IN_SECTION, along with a checkpoint under
+ *  RTCKIT_CHECKPOINT_INTERVAL, and switch the regulator off.  The wakeup is a reset: call
+ *  rtc_resume() from the pre-init hook for the fastest response, then rtc_init() as usual to
+ *  resume instead of restarting the RTC, and clear LOCKLPM5 to let RTC_ISR service the alarm.
+ *  Set the I/O pins up for LPM3.5 beforehand.
+ *
+ * @param[in] Handler for rtc_resume() to call on the wakeup, may be NULL
+ * @param[out] Only returns if LPM3.5 could not be entered: -1, for instance outside tickless
+ *             mode or with an interrupt pending
+ */
+int rtc_shutdown(rtcWakeHandler wake_fn);
+
+/** Minimal wakeup path, for _system_pre_init() or __low_level_init()
+ *  Tells whether this reset is a wakeup from rtc_shutdown() and, if so, calls its wake handler
+ *  with the alarm that's due.  Only registers and FRAM are read, so it can run before the C
+ *  runtime initializes; nothing is changed - rtc_init() completes the resume.
+ *
+ * @param[out] 1 on an LPM3.5 wakeup from rtc_shutdown(), 0 otherwise
+ */
+int rtc_resume(void);
+#endif /* ifdef RTCKIT_LPM35 */
+#endif
+
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+/** Arm an alarm table entry
+ *  The table is kept sorted by trigger time, so RTC_ISR only compares rtcepoch against the
+ *  earliest alarm no matter how many are armed.  An alarm whose time has already passed
+ *  triggers on the next tick.
+ *
+ * @param[in] Alarm ID, 0 to RTCKIT_ALARM_TABLE_SIZE-1 - re-arming an armed ID replaces it
+ * @param[in] The epoch timestamp at which the alarm triggers (must be > 0)
+ * @param[in] If > 0, the alarm re-arms itself this many seconds later each time it triggers
+ *            - the same as rtcalarm0_incr
+ * @param[out] 0 on success, -1 if the ID or timestamp is invalid
+ */
+int rtc_alarm_set(unsigned int id, unsigned long when, unsigned long incr);
+
+/** Arm an alarm table entry relative to the current time
+ *
+ * @param[in] Alarm ID
+ * @param[in] The number of seconds from now at which the alarm triggers
+ * @param[in] Re-arm period as for rtc_alarm_set()
+ * @param[out] 0 on success, -1 if the ID is invalid
+ */
+int rtc_alarm_set_in(unsigned int id, unsigned long secs, unsigned long incr);
+
+/** Disarm an alarm table entry and clear its rtc_alarm_triggered bit
+ *
+ * @param[in] Alarm ID
+ */
+void rtc_alarm_cancel(unsigned int id);
+
+/** Report when an alarm table entry triggers next
+ *
+ * @param[in] Alarm ID
+ * @param[out] Epoch timestamp, 0 if the alarm is not armed
+ */
+unsigned long rtc_alarm_get(unsigned int id);
+
+/** Report when the earliest armed alarm table entry triggers
+ *
+ * @param[out] Epoch timestamp, 0 if no alarm is armed
+ */
+unsigned long rtc_alarm_next(void);
+
+/** Works out when an alarm triggers next, once it has triggered - called from rtc_dispatch()
+ *
+ * @param[in] Alarm ID
+ * @param[in] rtcepoch as it triggered
+ * @param[out] The next trigger time - 0, or one no later than now, disarms the alarm
+ */
+typedef unsigned long (*rtcAlarmRearm)(unsigned int id, unsigned long now);
+
+/** Arm an alarm table entry that re-arms through a function instead of a fixed period
+ *  For repeats that aren't a fixed number of seconds apart - see rtc_alarm_set_rule().  The
+ *  function runs once per trigger, from the next rtc_dispatch() - RTC_ISR only takes the
+ *  alarm off the queue and wakes the main loop, and the alarm stays there until the main loop
+ *  has called rtc_dispatch().  A step back in time has it run again, from the new time.
+ *  The function pointer is not checkpointed: arm the alarm again after a reset.
+ *
+ * @param[in] Alarm ID
+ * @param[in] The epoch timestamp at which the alarm first triggers (must be > 0)
+ * @param[in] The re-arm function
+ * @param[out] 0 on success, -1 if the ID or timestamp is invalid
+ */
+int rtc_alarm_set_rearm(unsigned int id, unsigned long when, rtcAlarmRearm fn);
+#endif /* if RTCKIT_ALARM_TABLE_SIZE > 0 */
+
+#if defined(RTCKIT_LEGACY_ALARMS) || RTCKIT_ALARM_TABLE_SIZE > 0
+/** Late-alarm policies for rtc_alarm_policy()
+ *  A periodic alarm falls behind when rtcepoch is stepped forward past it, or an alarm is set
+ *  to a time that has gone by.  Either way it triggers on the next tick - never lost - and then:
+ *  RTC_ALARM_REALIGN: triggers just that once and moves on to its first occurrence still
+ *                     ahead, keeping its phase; the occurrences skipped count as missed.
+ *  RTC_ALARM_CATCHUP: triggers once per tick for every occurrence that has gone by, until
+ *                     it is back on time; the ones that trigger late count as missed.
+ */
+#define RTC_ALARM_REALIGN 0
+#define RTC_ALARM_CATCHUP 1
+
+/** Choose what a periodic alarm does when it has fallen behind - RTC_ALARM_REALIGN by default
+ *
+ * @param[in] Alarm table ID, or RTC_EVENT_ALARM0/RTC_EVENT_ALARM1 for rtcalarm0/rtcalarm1
+ * @param[in] RTC_ALARM_REALIGN or RTC_ALARM_CATCHUP
+ * @param[out] 0 on success, -1 if there is no such alarm
+ */
+int rtc_alarm_policy(unsigned int id, unsigned int policy);
+
+/** Report how many occurrences of an alarm were missed, as defined by its policy
+ *
+ * @param[in] Alarm table ID, or RTC_EVENT_ALARM0/RTC_EVENT_ALARM1
+ * @param[in] Non-zero to clear the count after reading it
+ * @param[out] The count, 0 if there is no such alarm
+ */
+unsigned int rtc_alarm_missed(unsigned int id, unsigned int reset);
+#endif
+
+#ifdef RTCKIT_CALLBACKS
+/** Event handler
+ *
+ * @param[in] What happened - RTC_EVENT_TICK, an alarm table ID, RTC_EVENT_ALARM0 or RTC_EVENT_ALARM1
+ * @param[in] rtcepoch when it happened
+ */
+typedef void (*rtcHandler)(unsigned int event, unsigned long epoch);
+
+/// Event numbers passed to handlers besides the alarm table IDs - see also RTC_EVENT_ALARM0/1
+#define RTC_EVENT_TICK   0xFF
+
+/// Handler flag: run the handler inside RTC_ISR instead of from rtc_dispatch()
+#define RTC_HANDLER_IN_ISR 0x0001
+
+/** Register the handler called on every RTC tick
+ *  In tickless mode RTC_ISR - and so the tick - only runs once per counter period.
+ *  Without RTC_HANDLER_IN_ISR, each tick wakes the chip from LPM3 so rtc_dispatch() can run.
+ *
+ * @param[in] The handler, NULL to remove it
+ * @param[in] RTC_HANDLER_IN_ISR or 0
+ */
+void rtc_on_tick(rtcHandler fn, unsigned int flags);
+
+/** Register the handler called when an alarm triggers
+ *  rtc_status and rtc_alarm_triggered are updated as before, so polling keeps working.
+ *
+ * @param[in] Alarm table ID, or RTC_EVENT_ALARM0/RTC_EVENT_ALARM1 for rtcalarm0/rtcalarm1
+ * @param[in] The handler, NULL to remove it
+ * @param[in] RTC_HANDLER_IN_ISR or 0
+ * @param[out] 0 on success, -1 if there is no such alarm
+ */
+int rtc_on_alarm(unsigned int id, rtcHandler fn, unsigned int flags);
+
+#endif /* ifdef RTCKIT_CALLBACKS */
+
+#if defined(RTCKIT_CALLBACKS) || RTCKIT_ALARM_TABLE_SIZE > 0
+/** Re-arm the alarms of rtc_alarm_set_rearm() that have triggered, then run the handlers of
+ *  the events RTC_ISR has queued, oldest first
+ *  Call from the main loop after waking up.  A handler removed since its event was queued is
+ *  skipped.
+ *
+ * @param[out] The number of handlers run
+ */
+unsigned int rtc_dispatch(void);
+#endif
+
+#ifdef RTCKIT_CHECKPOINT_INTERVAL
+/** Write rtcepoch and the alarms to the FRAM checkpoint now
+ *  Call this right before the chip may lose power - entering LPM4.5, say - so the time restored by
+ *  rtc_init() afterwards is exact up to the time spent powered off.
+ */
+void rtc_checkpoint(void);
+
+/** Report how far behind the time restored by rtc_init() may be
+ *  rtc_init() restores the checkpoint when rtcepoch is still 0 after the reset and sets
+ *  RTC_EPOCH_RESTORED in rtc_status.  Time spent powered off is not known and not included.
+ *
+ * @param[out] 0 if the checkpoint came from rtc_checkpoint(), RTCKIT_CHECKPOINT_INTERVAL if it was
+ *             a periodic one or 0 if nothing was restored
+ */
+unsigned long rtc_checkpoint_uncertainty(void);
+#endif
 
 /** Convert RTC Epoch seconds into a struct tm
+ *  Runs in constant time - no loops over leap cycles or months - for any date 1970-2106.
  *
  * @param[in] Epoch time in seconds since the epoch (Jan 1 1970 midnight UTC)
  * @param[out] Time/Datestamp in "struct tm" format - Note a static buffer is used here,
@@ -130,17 +671,524 @@ void rtc_init(unsigned int rtc_clock_source);
  */
 struct tm * rtc_interpret(unsigned long);
 
+/** Convert RTC Epoch seconds into a caller-supplied struct tm
+ *  Reentrant version of rtc_interpret() - safe to use from an ISR and the main loop at once.
+ *
+ * @param[in] Epoch time in seconds since the epoch (Jan 1 1970 midnight UTC)
+ * @param[in] Pointer to the struct tm buffer to fill
+ * @param[out] The same buffer pointer
+ */
+struct tm * rtc_interpret_r(unsigned long, struct tm *);
+
+/** Convert RTC Epoch seconds into a caller-supplied struct rtc_datetime
+ *  This is the conversion underneath rtc_interpret() - the fields are filled directly.
+ *
+ * @param[in] Epoch time in seconds since the epoch (Jan 1 1970 midnight UTC)
+ * @param[in] Pointer to the struct rtc_datetime buffer to fill
+ * @param[out] The same buffer pointer
+ */
+struct rtc_datetime * rtc_interpret_dt(unsigned long, struct rtc_datetime *);
+
+/// Conversion state carried between the epochs of a batch - see rtc_batch_next()
+struct rtcBatch
+{
+    unsigned long day_start;   /* epoch of midnight of the day in dt */
+    struct rtc_datetime dt;    /* the last conversion */
+};
+
+/** Get a struct rtcBatch ready for rtc_batch_next()
+ *
+ * @param[in] Pointer to the batch state
+ */
+void rtc_batch_init(struct rtcBatch *batch);
+
+/** Convert the next of a series of epochs - a log dump, say - one at a time
+ *  While consecutive epochs fall on the same day only the time of day is recomputed, a
+ *  subtraction and three multiplies; the date is reused.  Sorted or nearly sorted input gets
+ *  the most from this, but any order gives correct results.
+ *
+ * @param[in] Pointer to the batch state
+ * @param[in] Epoch time in seconds since the epoch (Jan 1 1970 midnight UTC)
+ * @param[out] Pointer to the result inside the batch state - valid until the next call
+ */
+const struct rtc_datetime * rtc_batch_next(struct rtcBatch *batch, unsigned long epoch);
+
+/** Convert an array of epochs into an array of struct tm
+ *  rtc_batch_next() over the whole array.
+ *
+ * @param[in] The epochs
+ * @param[in] How many there are
+ * @param[in] Array of n struct tm receiving the conversions
+ */
+void rtc_interpret_batch(const unsigned long *epochs, unsigned int n, struct tm *out);
+
+/** Return the current time (rtcepoch) as a struct tm
+ *
+ *  The buffer is carried forward from the previous call - a call per RTC_TICK costs a few
+ *  compares instead of a full rtc_interpret().  It is fully recomputed on the first call, when
+ *  rtcepoch has been written by user code, or when more than a minute passed since the last call.
+ *  On the RTC_C backend it is filled from the hardware calendar, with no conversion at all.
+ *
+ * @param[out] Time/Datestamp in "struct tm" format - Note a static buffer is used here, separate
+               from rtc_interpret()'s; do not modify its contents.
+ */
+struct tm * rtc_now_tm(void);
+
 /** Convert struct tm time structure into Epoch seconds
+ *  The fields must be in range - use rtc_normalize() for a struct that has been edited.
  *
  * @param[in] A pointer to a "struct tm" with tm_year, tm_mon, tm_mday, tm_hour, tm_min,
  *            tm_sec filled out - optionally tm_mon/tm_mday may be omitted if tm_yday is supplied.
- * @param[out] Timestamp in epoch - seconds since Jan 1 1970 midnight UTC
+ * @param[out] Timestamp in epoch - seconds since Jan 1 1970 midnight UTC - or 0 if tm_year
+ *             is outside 1970-2106 or the time is past Feb 7 2106 06:28:15
  */
 unsigned long rtc_epoch(struct tm *);
 
+/** Normalize a struct tm and convert it into Epoch seconds, as mktime() does
+ *  Any field may be out of range in either direction and they all carry in one pass:
+ *  tm_min = 75 is 1:15 past tm_hour, tm_mday = 0 the last day of the month before, tm_mon = 12
+ *  January of the next year.  The struct is rewritten with the date that results, tm_yday and
+ *  tm_wday included; on input those two are ignored.  tm_isdst is cleared.
+ *
+ * @param[in] A pointer to the "struct tm" - tm_year is the full year
+ * @param[out] Timestamp in epoch, or 0 if the result is outside Jan 1 1970 to Feb 7 2106
+ *             06:28:15, or the year - once the months are carried - is outside 1969-2107
+ *             (the struct is then left alone)
+ */
+unsigned long rtc_normalize(struct tm *timebuf);
+
+/** Convert a struct rtc_datetime into Epoch seconds
+ *  yday and wday are not looked at.
+ *
+ * @param[in] Pointer to a date in range, Jan 1 1970 to Feb 7 2106 06:28:15
+ * @param[out] Timestamp in epoch
+ */
+unsigned long rtc_dt_epoch(const struct rtc_datetime *dt);
+
+/** Move a date by a number of days, keeping the time of day
+ *
+ * @param[in] Pointer to the date - yday and wday are updated
+ * @param[in] Days to add, negative to go back
+ * @param[out] 0 on success, -1 if the date would leave 1970-2106 (dt is left alone)
+ */
+int rtc_add_days(struct rtc_datetime *dt, long days);
+
+/** Move a date by a number of calendar months, keeping the time of day
+ *  A day past the end of the new month is held at its last day - Jan 31 plus one month is
+ *  Feb 28 or 29 - unlike rtc_normalize(), which would roll it on into March.
+ *
+ * @param[in] Pointer to the date - yday and wday are updated
+ * @param[in] Months to add, negative to go back
+ * @param[out] 0 on success, -1 if the year would leave 1970-2106 (dt is left alone)
+ */
+int rtc_add_months(struct rtc_datetime *dt, int months);
+
+/** Midnight at the end of the day an epoch falls on
+ *  For local midnight, pass a local epoch - e.g. epoch + rtc_tz_offset(epoch, NULL) - and
+ *  subtract the offset from the result.
+ *
+ * @param[in] Epoch time in seconds, before Feb 7 2106
+ * @param[out] Epoch of the next midnight, always later than the epoch given
+ */
+unsigned long rtc_next_midnight(unsigned long epoch);
+
+/** Midnight at the start of the week an epoch falls in
+ *
+ * @param[in] Epoch time in seconds
+ * @param[in] Day the week starts on, days since Sunday, 0-6 - 0 for Sunday, 1 for Monday;
+ *            a larger value is taken modulo 7
+ * @param[out] Epoch of that midnight, on or before the epoch given - 0 for a week that began
+ *             in 1969
+ */
+unsigned long rtc_start_of_week(unsigned long epoch, unsigned int first_wday);
+
+/** Hit and miss counts of the conversion cache
+ *  rtc_interpret_dt() - and so everything built on it - keeps the date of the last day it
+ *  converted; any epoch on that day costs a subtraction, a compare and the hour/minute/second
+ *  split.
+ */
+struct rtcCacheStats
+{
+    unsigned long interpret_hits;
+    unsigned long interpret_misses;
+};
+
+/** Read the conversion cache counters
+ *  Counts made by conversions in an ISR may be lost if one interrupts another's count update.
+ *
+ * @param[in] Pointer receiving the counters
+ * @param[in] Non-zero to clear the counters after reading them
+ */
+void rtc_cache_stats(struct rtcCacheStats *stats, unsigned int reset);
+
+#ifdef RTCKIT_STATS
+/// Runtime counters kept by RTC_ISR and the API, read with rtc_stats()
+struct rtcStats
+{
+    unsigned long isr_entries;     /* RTC_ISR runs, ticks inside the second included           */
+    unsigned long wakeups;         /* RTC_ISR exits that woke the chip out of low-power mode   */
+    unsigned int alarms_fired;     /* Legacy and alarm table alarms that went off              */
+    unsigned int alarms_missed;    /* Alarm table alarms that went off after their time        */
+    unsigned int isr_cycles_max;   /* Longest RTC_ISR run in RTCKIT_STATS_TIMER counts, or 0   */
+    unsigned long checkpoint_age;  /* Seconds since the last FRAM checkpoint, or 0 without one */
+    struct rtcCacheStats cache;    /* As from rtc_cache_stats()                                */
+};
+
+/** Read the runtime counters
+ *
+ * @param[in] Pointer receiving the counters
+ * @param[in] Non-zero to clear the counters - and the cache counters - after reading them
+ */
+void rtc_stats(struct rtcStats *stats, unsigned int reset);
+#endif
+
+/** Timezones
+ *  Local time follows one rule set at a time, selected with rtc_tz_set() - UTC until then.
+ *  The UTC offset in effect is cached along with the epochs of the DST transitions either side,
+ *  so rtc_interpret_local() costs one compare and one add over rtc_interpret() until the next
+ *  transition passes.
+ */
+
+/// DST transition rule - POSIX "Mm.w.d/time": weekday d of week w (5 = last) of month m
+struct rtcTzRule
+{
+    unsigned char mon;     /* month                       - [1,12]  */
+    unsigned char week;    /* week of the month, 5 = last - [1,5]   */
+    unsigned char wday;    /* days since Sunday           - [0,6]   */
+    long time;             /* local time of day, seconds, before the transition */
+};
+
+/// Timezone - offsets are in seconds EAST of UTC (CET is +3600), unlike the POSIX TZ string
+struct rtcTimezone
+{
+    long std_offset;
+    long dst_offset;       /* same as std_offset for a zone without DST */
+    struct rtcTzRule dst_start;
+    struct rtcTzRule dst_end;
+};
+
+/** Fill a struct rtcTimezone from a POSIX TZ string, e.g. "CET-1CEST,M3.5.0,M10.5.0/3"
+ *  Only the M form of the transition rules is understood; a zone without DST is just
+ *  "JST-9".
+ *
+ * @param[in] The TZ string
+ * @param[in] Pointer to the struct rtcTimezone to fill
+ * @param[out] 0 on success, -1 if the string could not be parsed
+ */
+int rtc_tz_parse(const char *posix, struct rtcTimezone *tz);
+
+/** Select the timezone used for local time
+ *
+ * @param[in] Pointer to the rules - copied, so it need not stay around
+ */
+void rtc_tz_set(const struct rtcTimezone *tz);
+
+/** Report the UTC offset in effect at a given time
+ *
+ * @param[in] Epoch timestamp
+ * @param[in] Pointer receiving 1 if DST is in effect, 0 if not (may be NULL)
+ * @param[out] Seconds to add to UTC for local time
+ */
+long rtc_tz_offset(unsigned long epoch, unsigned int *isdst);
+
+/** Report the next DST transition after a given time
+ *
+ * @param[in] Epoch timestamp
+ * @param[out] Epoch of the transition, 0 if the timezone has no DST
+ */
+unsigned long rtc_tz_next_transition(unsigned long epoch);
+
+/** Convert RTC Epoch seconds into local time as a struct tm
+ *  As rtc_interpret(), with tm_isdst set.
+ *
+ * @param[in] Epoch time in seconds since the epoch (Jan 1 1970 midnight UTC)
+ * @param[out] Local time in "struct tm" format - in a static buffer separate from
+ *             rtc_interpret()'s
+ */
+struct tm * rtc_interpret_local(unsigned long);
+
+/** Convert RTC Epoch seconds into local time in a caller-supplied struct tm
+ *
+ * @param[in] Epoch time in seconds since the epoch (Jan 1 1970 midnight UTC)
+ * @param[in] Pointer to the struct tm buffer to fill
+ * @param[out] The same buffer pointer
+ */
+struct tm * rtc_interpret_local_r(unsigned long, struct tm *);
+
+/** Calendar rule - rtckit_cal.c
+ *  Matches the given time of day on every day allowed by all three masks; a mask left 0
+ *  allows any.  "Weekdays at 07:30 local" is { 0, 0, 0x3E, 7, 30, 0, RTC_CAL_LOCAL }, "the
+ *  1st of every month at midnight" is { 0x00000001, 0, 0, 0, 0, 0, 0 }.
+ */
+struct rtcCalRule
+{
+    unsigned long mdays;   /* days of the month, bit 0 = the 1st - 0 for any */
+    unsigned int months;   /* bit 0 = January                    - 0 for any */
+    unsigned char wdays;   /* bit 0 = Sunday                     - 0 for any */
+    unsigned char hour;    /* time of day the rule fires at                  */
+    unsigned char min;
+    unsigned char sec;
+    unsigned char flags;   /* RTC_CAL_ flags                                 */
+};
+
+/// The rule's time of day is local time, as set by rtc_tz_set(), rather than UTC
+#define RTC_CAL_LOCAL 0x01
+
+/** Work out the first time after a given one that a calendar rule matches
+ *  Starts from one rtc_interpret_dt() and steps a day - or a month the rule leaves out - at
+ *  a time, without converting again.
+ *
+ * @param[in] The rule
+ * @param[in] Epoch timestamp to search after
+ * @param[out] The next matching timestamp, 0 if there is none in the next 8 years
+ */
+unsigned long rtc_cal_next(const struct rtcCalRule *rule, unsigned long after);
+
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+/** Arm an alarm table entry from a calendar rule - cron-like repeats
+ *  The library works out the next matching time each time the alarm triggers, through
+ *  rtc_alarm_set_rearm(); rtc_alarm_set() or rtc_alarm_cancel() on the ID drops the rule.
+ *
+ * @param[in] Alarm ID
+ * @param[in] The rule - copied, so it need not stay around
+ * @param[out] 0 on success, -1 if the ID is invalid or the rule never matches
+ */
+int rtc_alarm_set_rule(unsigned int id, const struct rtcCalRule *rule);
+#endif
+
+/** Format RTC Epoch seconds as an ISO 8601 UTC timestamp, "2026-10-14T09:30:00Z"
+ *  Needs neither printf nor a divide - see rtckit_format.c.
+ *
+ * @param[in] Epoch time in seconds since the epoch (Jan 1 1970 midnight UTC)
+ * @param[in] Buffer receiving the timestamp - RTC_ISO8601_LEN+1 bytes including the terminator
+ * @param[out] Length written, not counting the terminator - always RTC_ISO8601_LEN
+ */
+unsigned int rtc_format_iso8601(unsigned long epoch, char *buf);
+
+#define RTC_ISO8601_LEN 20
+
+/** Format an array of epochs as ISO 8601 timestamps, each followed by a separator
+ *  The conversions go through rtc_batch_next(), so runs of timestamps from the same day only
+ *  recompute the time of day.
+ *
+ * @param[in] The epochs
+ * @param[in] How many there are
+ * @param[in] Buffer receiving the text - n * (RTC_ISO8601_LEN+1) + 1 bytes including the terminator
+ * @param[in] Character written after each timestamp, e.g. '\n'
+ * @param[out] Length written, not counting the terminator
+ */
+unsigned int rtc_format_iso8601_batch(const unsigned long *epochs, unsigned int n, char *buf, char sep);
+
+/** Format a struct tm the way strftime() would, for a subset of its conversions
+ *  %Y %y %m %d %e %H %I %M %S %p %j %w %a %A %b %B %F %T %R %D %n %t %% are understood;
+ *  anything else after a % is copied as it is.  The names come from dayInfo[] and monthInfo[],
+ *  so with %a %A %b %B the build needs rtckit_names.c.  A field outside its struct tm range
+ *  (tm_year outside 0-9999, tm_sec past 60) gets 0 back and nothing written.
+ *
+ * @param[in] Buffer to write into
+ * @param[in] Size of the buffer, including room for the terminator
+ * @param[in] Format string
+ * @param[in] Pointer to the time to format - from rtc_interpret(), rtc_interpret_local() etc.
+ * @param[out] Length written, not counting the terminator - 0 if it didn't fit or a field was out of range
+ */
+unsigned int rtc_strftime(char *buf, unsigned int size, const char *fmt, const struct tm *timebuf);
+
+/** Parse an ISO 8601 timestamp into an epoch
+ *  "2026-10-14T09:30:00Z", "2026-10-14 11:30:00+02:00", "2026-10-14T09:30" or just
+ *  "2026-10-14".  A fraction of a second is dropped; no zone designator means UTC.
+ *
+ * @param[in] The timestamp - the whole string must match
+ * @param[in] Pointer receiving the epoch
+ * @param[out] 0 on success, -1 if the string is malformed or the date is invalid (*epoch is
+ *             left alone)
+ */
+int rtc_parse_iso8601(const char *s, unsigned long *epoch);
+
+/** Parse an HTTP-date ("Sun, 06 Nov 1994 08:49:37 GMT") into an epoch
+ *  Only the IMF-fixdate form is accepted.  The weekday must match the date.
+ *
+ * @param[in] The date string - the whole string must match
+ * @param[in] Pointer receiving the epoch
+ * @param[out] 0 on success, -1 if the string is malformed or the date is invalid (*epoch is
+ *             left alone)
+ */
+int rtc_parse_http_date(const char *s, unsigned long *epoch);
+
+/// State of the NMEA RMC parser - treat as opaque
+struct rtcNmeaParser
+{
+    unsigned char state;
+    unsigned char field;
+    unsigned char pos;
+    unsigned char sum;
+    unsigned char rxsum;
+    unsigned char flags;
+    unsigned char digits[12];  /* hhmmss ddmmyy */
+};
+
+/** Get an NMEA parser ready for rtc_nmea_feed()
+ *
+ * @param[in] Pointer to the parser state
+ */
+void rtc_nmea_init(struct rtcNmeaParser *p);
+
+/** Feed one character from a GPS receiver to the NMEA RMC parser
+ *  Call it straight from the UART receive path.  Sentences other than RMC (from any talker,
+ *  $GPRMC, $GNRMC...) are skipped; an RMC sentence produces an epoch once its checksum is
+ *  verified, provided its status is A (valid fix) and its date and time are in range.
+ *
+ * @param[in] Pointer to the parser state
+ * @param[in] The received character
+ * @param[in] Pointer receiving the epoch - the time at which the sentence's fix was taken
+ * @param[out] 1 when a valid RMC sentence has just completed and *epoch was set, 0 otherwise
+ */
+int rtc_nmea_feed(struct rtcNmeaParser *p, char c, unsigned long *epoch);
+
+/** Timestamp log - rtckit_log.c
+ *  A ring of fixed-size blocks, normally in FRAM, holding records of rec_size bytes each.  The
+ *  first record of a block is stamped with its whole epoch; the others with the 8- or 16-bit
+ *  difference from the record before, in seconds or - with RTC_LOG_TICKS - RTC counts.  A
+ *  difference that doesn't fit, or time going backwards, starts the next block early.  Once the
+ *  ring is full, the oldest block is dropped to make room.  Each block's record count is written
+ *  last, so a reset in the middle of rtc_log_write() loses at most the records it was writing.
+ *  The struct rtcLog belongs in FRAM alongside its storage, so the log survives a reset.  It
+ *  keeps the stamp of the newest record, so a write costs the same however full the block is;
+ *  after a reset that cut a write short, the next write works it out again from the block.
+ */
+struct rtcLog
+{
+    unsigned char *buf;         /* storage                                        */
+    unsigned int block_size;    /* bytes per block                                */
+    unsigned int nblocks;       /* blocks in buf                                  */
+    unsigned int tps;           /* RTC counts per second, with RTC_LOG_TICKS      */
+    unsigned int first;         /* oldest block                                   */
+    unsigned int last;          /* block being filled                             */
+    unsigned long last_epoch;   /* stamp of the newest record...                  */
+    unsigned int last_ticks;
+    unsigned char rec_size;     /* bytes of data per record                       */
+    unsigned char per_block;    /* records per block                              */
+    unsigned char flags;        /* RTC_LOG_*                                      */
+    unsigned char last_count;   /* ...valid while block last holds this many      */
+};
+
+/// rtc_log_init() flags: 16-bit differences instead of 8-bit, in RTC counts instead of seconds
+#define RTC_LOG_DELTA16   0x01
+#define RTC_LOG_TICKS     0x02
+
+/// Position of a reader in a log - see rtc_log_read()
+struct rtcLogCursor
+{
+    unsigned int block;
+    unsigned int index;         /* next record within the block */
+    unsigned long epoch;        /* stamp of the record before   */
+    unsigned int ticks;
+};
+
+/** Lay out an empty log over a buffer
+ *  Each block takes 5 bytes for the first stamp (7 with RTC_LOG_TICKS), 1 or 2 bytes for each
+ *  of the others and per_block * rec_size bytes of data.  With RTC_LOG_TICKS, the RTC must be
+ *  running already - the counts per second are taken from rtc_ticks_per_second().
+ *
+ * @param[in] Pointer to the log
+ * @param[in] Storage, normally FRAM
+ * @param[in] Size of the storage in bytes - room for two blocks or more
+ * @param[in] Bytes of data per record, 0 to 255
+ * @param[in] Records per block, 1 to 255 - one whole stamp per this many records
+ * @param[in] RTC_LOG_* flags
+ * @param[out] 0 on success, -1 if the layout doesn't fit
+ */
+int rtc_log_init(struct rtcLog *log, void *buf, unsigned int size, unsigned int rec_size,
+                 unsigned int per_block, unsigned int flags);
+
+/** Append records to a log
+ *  FRAM write protection is lifted once for the whole batch, so gathering records in SRAM and
+ *  writing them together is cheaper than a call per record.  Stamps should not go backwards;
+ *  those that do just start a new block.
+ *
+ * @param[in] Pointer to the log
+ * @param[in] The record epochs
+ * @param[in] Their RTC counts into the second, as from rtc_now_ticks() - NULL for all 0;
+ *            ignored without RTC_LOG_TICKS
+ * @param[in] n * rec_size bytes of record data - may be NULL if rec_size is 0
+ * @param[in] How many records
+ */
+void rtc_log_write(struct rtcLog *log, const unsigned long *epochs, const unsigned int *ticks,
+                   const void *data, unsigned int n);
+
+/** Append one record stamped with the current time
+ *
+ * @param[in] Pointer to the log
+ * @param[in] rec_size bytes of record data
+ */
+void rtc_log_stamp(struct rtcLog *log, const void *data);
+
+/** Point a cursor at the oldest record of a log
+ *
+ * @param[in] Pointer to the log
+ * @param[in] Pointer to the cursor
+ */
+void rtc_log_rewind(const struct rtcLog *log, struct rtcLogCursor *cur);
+
+/** Read records from a log, oldest first
+ *  The epochs come back whole, ready for rtc_interpret_batch() or rtc_batch_next().  Records
+ *  written meanwhile are picked up by the next call; a cursor whose block has been dropped by
+ *  rtc_log_write() since should be rewound.
+ *
+ * @param[in] Pointer to the log
+ * @param[in] Pointer to the cursor, from rtc_log_rewind()
+ * @param[in] Array receiving up to n epochs
+ * @param[in] Array receiving their RTC counts into the second - may be NULL
+ * @param[in] Buffer receiving n * rec_size bytes of record data - may be NULL
+ * @param[in] How many records at most
+ * @param[out] How many records were read - 0 at the end of the log
+ */
+unsigned int rtc_log_read(const struct rtcLog *log, struct rtcLogCursor *cur, unsigned long *epochs,
+                          unsigned int *ticks, void *data, unsigned int n);
+
+/** Compile-time epoch construction
+ *  RTC_EPOCH(2027, 1, 1, 0, 0, 0) folds to the epoch of Jan 1 2027 midnight UTC as an integer
+ *  constant, so it costs nothing at runtime - use it for alarm initializers, expiry dates and the
+ *  like.  Note mo is the calendar month, 1-12, and d the day of the month, 1-31.  rtc_epoch()
+ *  uses the same leap-year arithmetic.  Arguments are evaluated more than once.
+ */
+#define RTC_EPOCH(y, mo, d, h, mi, s) \
+    (RTC_DAYS(y, mo, d) * 86400UL + (h) * 3600UL + (mi) * 60UL + (s))
+
+/// Days from Jan 1 1970 to the given date (mo 1-12, d 1-31)
+#define RTC_DAYS(y, mo, d) \
+    (365UL * ((y) - 1970) + RTC_LEAPS_BEFORE(y) + RTC_YDAY_BEFORE(y, mo) + (d) - 1)
+
+/// Gregorian leap year test
+#define RTC_IS_LEAP(y) ((((y) % 4) == 0 && ((y) % 100) != 0) || ((y) % 400) == 0)
+
+/// Number of leap years from 1970 up to, not including, year y
+#define RTC_LEAPS_BEFORE(y) \
+    (((y) - 1) / 4 - 492 - (((y) - 1) / 100 - 19) + (((y) - 1) / 400 - 4))
+
+/// Days in year y before the first of month mo (1-12)
+#define RTC_YDAY_BEFORE(y, mo) \
+    ((367 * (mo) - 362) / 12 - ((mo) <= 2 ? 0 : (RTC_IS_LEAP(y) ? 1 : 2)))
+
 /// Internal defines used by the library
 #define TOTAL_SECONDS_PER_LEAP_CYCLE ((86400*365)*3 + (86400*366))
 #define EPOCH_AFTER_FIRST_LEAPYEAR ((86400*365)*2 + (86400*366))
+#define RTC_DAYS_1968_TO_EPOCH 731
+#define RTC_DAYS_1968_TO_MAR1_2100 48272
+
+#ifdef __cplusplus
+}
+
+namespace rtckit {
+
+/// C++ twin of RTC_EPOCH() - usable in constant expressions, with each argument evaluated once
+constexpr unsigned long epoch(unsigned int y, unsigned int mo, unsigned int d,
+                              unsigned int h = 0, unsigned int mi = 0, unsigned int s = 0)
+{
+    return RTC_EPOCH(y, mo, d, h, mi, s);
+}
+
+}  // namespace rtckit
+#endif /* ifdef __cplusplus */
 
 
 #endif /* RTCKIT_H */
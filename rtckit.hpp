@@ -0,0 +1,371 @@
+/**
+  * MSP430 Real Time Clock Kit - C++ front-end
+  *
+  * A header-only template over the C library: the clock source, tick rate and alarm count of
+  * a product go in as template arguments, the prescaler and modulo are worked out
+  * by the compiler, and rtc_init_preset() is all that's left for the chip to run.  RTC_ISR can
+  * be put together from the steps of only the features the product lists, with RTCKIT_ISR().
+  *
+  * @author Eric Brundick <spirilis at linux dot com>
+  * @file rtckit.hpp
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#ifndef RTCKIT_HPP
+#define RTCKIT_HPP
+#include <msp430.h>
+#include "rtckit.h"
+#include "rtckit_isr.h"
+
+#if __cplusplus < 201703L
+#error "rtckit.hpp needs C++17 (if constexpr)"
+#endif
+
+namespace rtckit {
+
+/// RTC clock sources - the RTC_CLOCK_* defines the backend has
+enum class Clock : unsigned int {
+    XT1 = RTC_CLOCK_XT1CLK,
+    #ifdef RTC_CLOCK_VLOCLK
+    VLO = RTC_CLOCK_VLOCLK,
+    #endif
+    #ifdef RTC_CLOCK_SMCLK
+    SMCLK = RTC_CLOCK_SMCLK
+    #endif
+};
+
+/// Optional parts of the C library, one per RTCKIT_* switch in rtckit.h
+enum class Feature {
+    Tickless,        /* RTCKIT_TICKLESS - Rtc::init() starts in tickless mode when listed */
+    LegacyAlarms,    /* RTCKIT_LEGACY_ALARMS - Rtc::isr() checks rtcalarm0/1 when listed  */
+    DaySec,          /* RTCKIT_DAYSEC - Rtc::isr() keeps rtc_day/rtc_sod when listed      */
+    Callbacks,       /* RTCKIT_CALLBACKS - Rtc::isr() queues the tick handler when listed */
+    VloCalibration,  /* RTCKIT_VLO_CALIBRATION                                             */
+    Stats,           /* RTCKIT_STATS                                                       */
+    Checkpoint       /* RTCKIT_CHECKPOINT_INTERVAL - Rtc::isr() saves it when listed      */
+};
+
+/// Whether rtckit.c is built with a feature
+constexpr bool compiled_in(Feature f)
+{
+    switch (f) {
+    #ifdef RTCKIT_TICKLESS
+    case Feature::Tickless:
+    #endif
+    #ifdef RTCKIT_LEGACY_ALARMS
+    case Feature::LegacyAlarms:
+    #endif
+    #ifdef RTCKIT_DAYSEC
+    case Feature::DaySec:
+    #endif
+    #ifdef RTCKIT_CALLBACKS
+    case Feature::Callbacks:
+    #endif
+    #ifdef RTCKIT_VLO_CALIBRATION
+    case Feature::VloCalibration:
+    #endif
+    #ifdef RTCKIT_STATS
+    case Feature::Stats:
+    #endif
+    #ifdef RTCKIT_CHECKPOINT_INTERVAL
+    case Feature::Checkpoint:
+    #endif
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// A prescaler and modulo, as rtc_init_ex() would pick them
+struct Setting
+{
+    unsigned int prescaler;  /* Prescaler divider, 0 if nothing fits    */
+    unsigned int counts;     /* RTC counts per tick - WDT: source Hz    */
+    long error_ppm;          /* Positive if the ticks come too fast     */
+};
+
+/** The same search as rtc_init_ex(), for the compiler to run
+ *  Every prescaler of the backend is tried with the nearest modulo; the closest rate wins, and
+ *  at equal error the larger prescaler does as long as it leaves 100 or more counts per tick.
+ *  The WDT has no modulo: the longest interval giving tick_hz is taken, with no error.
+ *
+ * @param[in] Frequency of the source in Hz
+ * @param[in] Ticks per second, 1 to 1024
+ * @param[in] Largest counts * tick_hz allowed - 0x7FFF in tickless mode
+ */
+constexpr Setting choose(unsigned long source_hz, unsigned int tick_hz, unsigned long limit = 0xFFFF)
+{
+    #if RTCKIT_BACKEND == RTCKIT_BACKEND_TIMER_A
+    constexpr unsigned int divs[] = { 1, 2, 4, 8, 16, 32, 64 };
+    #elif RTCKIT_BACKEND == RTCKIT_BACKEND_WDT
+    constexpr unsigned int divs[] = { 64, 512, 8192, 32768U };
+    #elif RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+    constexpr unsigned int divs[] = { 1 };
+    #else
+    constexpr unsigned int divs[] = { 1, 10, 16, 64, 100, 256, 1000, 1024 };
+    #endif
+    constexpr unsigned long min_resolution = 100;
+    Setting best = { 0, 0, 0 };
+    unsigned long best_ppm = 0xFFFFFFFFUL;
+
+    if (source_hz == 0 || tick_hz == 0 || tick_hz > 1024) {
+        return best;
+    }
+    #if RTCKIT_BACKEND == RTCKIT_BACKEND_WDT
+    (void)limit;
+    (void)min_resolution;
+    (void)best_ppm;
+    for (unsigned int div : divs) {
+        if ((unsigned long)div * tick_hz <= source_hz && source_hz + div <= 0x10000UL) {
+            best = { div, (unsigned int)source_hz, 0 };
+        }
+    }
+    #else
+    for (unsigned int div : divs) {
+        unsigned long div_hz = (unsigned long)div * tick_hz;
+        unsigned long c = (source_hz + div_hz / 2) / div_hz;
+        if (c < 2 || c * tick_hz > limit) {
+            continue;
+        }
+        unsigned long rate = c * div_hz;
+        unsigned long off = (source_hz > rate) ? source_hz - rate : rate - source_hz;
+        // Scaled as rtc_init_ex() does it, so the two agree on every tie
+        unsigned long span = rate;
+        for ( ; span >= 0x400000UL; span >>= 1) {
+            off >>= 1;
+        }
+        off *= 1000;
+        unsigned long ppm = (off / span) * 1000 + ((off % span) * 1000 + span / 2) / span;
+        if (ppm < best_ppm ||
+            (ppm == best_ppm && (c >= min_resolution ?
+                                 (best.counts < min_resolution || div > best.prescaler) :
+                                 c > best.counts))) {
+            best_ppm = ppm;
+            best.prescaler = div;
+            best.counts = (unsigned int)c;
+            best.error_ppm = (source_hz > rate) ? (long)ppm : -(long)ppm;
+        }
+    }
+    #endif
+    return best;
+}
+
+/// Nominal frequency of a clock source - SMCLK has none, so its frequency must be given
+constexpr unsigned long nominal_hz(Clock source)
+{
+    #ifdef RTC_CLOCK_VLOCLK
+    return source == Clock::XT1 ? 32768UL : source == Clock::VLO ? 10000UL : 0UL;
+    #else
+    return source == Clock::XT1 ? 32768UL : 0UL;
+    #endif
+}
+
+/** The RTC of one product: what it is clocked from, how often it ticks, how many alarm table
+ *  entries it uses and which optional features it relies on.
+ *
+ *  using Clock = rtckit::Rtc<rtckit::Clock::XT1, 0, 1, 2, rtckit::Feature::Tickless>;
+ *  Clock::init();
+ *  Clock::alarm<0>(rtckit::epoch(2030, 1, 1));
+ *
+ *  Clock::isr() is RTC_ISR with only the steps of the listed features, and of the alarm table
+ *  if NumAlarms isn't 0 - RTCKIT_ISR(Clock) places it on the vector.  Every feature listed
+ *  here must be compiled in; static_assert(Clock::lean) also checks nothing more is.
+ *
+ * @param Source   Clock source
+ * @param SourceHz Frequency of the source in Hz, 0 for the nominal 32768Hz/10kHz
+ * @param TickHz   Ticks per second, 1 to 1024
+ * @param NumAlarms Alarm table entries used, up to RTCKIT_ALARM_TABLE_SIZE
+ * @param Features Optional features the product relies on
+ */
+template <Clock Source, unsigned long SourceHz = 0, unsigned int TickHz = 1, unsigned int NumAlarms = 0,
+          Feature... Features>
+class Rtc
+{
+public:
+    /// Whether a feature is listed
+    static constexpr bool uses(Feature f)
+    {
+        return ((f == Features) || ...);
+    }
+
+    static constexpr unsigned long source_hz = SourceHz ? SourceHz : nominal_hz(Source);
+    static constexpr unsigned int tick_hz = TickHz;
+    static constexpr Setting setting = choose(source_hz, TickHz, uses(Feature::Tickless) ? 0x7FFF : 0xFFFF);
+    static constexpr unsigned int prescaler = setting.prescaler;
+    static constexpr unsigned int counts = setting.counts;
+    static constexpr long error_ppm = setting.error_ppm;
+
+    /// True when everything compiled into rtckit.c is listed, so nothing is carried unused
+    static constexpr bool lean =
+        (!compiled_in(Feature::Tickless) || uses(Feature::Tickless)) &&
+        (!compiled_in(Feature::LegacyAlarms) || uses(Feature::LegacyAlarms)) &&
+        (!compiled_in(Feature::DaySec) || uses(Feature::DaySec)) &&
+        (!compiled_in(Feature::Callbacks) || uses(Feature::Callbacks)) &&
+        (!compiled_in(Feature::VloCalibration) || uses(Feature::VloCalibration)) &&
+        (!compiled_in(Feature::Stats) || uses(Feature::Stats)) &&
+        (!compiled_in(Feature::Checkpoint) || uses(Feature::Checkpoint)) &&
+        NumAlarms == RTCKIT_ALARM_TABLE_SIZE;
+
+    static_assert(source_hz != 0, "SMCLK has no nominal frequency - give SourceHz");
+    static_assert(TickHz >= 1 && TickHz <= 1024, "TickHz must be 1 to 1024");
+    static_assert(!uses(Feature::Tickless) || TickHz == 1, "tickless mode needs a 1Hz tick");
+    static_assert(counts != 0, "no prescaler/modulo setting gives this tick rate from this source");
+    static_assert(RTCKIT_BACKEND != RTCKIT_BACKEND_RTC_C || (TickHz == 1 && counts == 32768U),
+                  "the RTC_C calendar ticks at 1Hz from a 32768Hz XT1");
+    static_assert(NumAlarms <= RTCKIT_ALARM_TABLE_SIZE, "NumAlarms exceeds RTCKIT_ALARM_TABLE_SIZE");
+    static_assert((compiled_in(Features) && ...), "a listed Feature is not compiled into rtckit.c");
+
+    /// Start the RTC - rtc_init_preset() with the setting worked out above
+    static int init()
+    {
+        unsigned int source = static_cast<unsigned int>(Source);
+
+        if constexpr (uses(Feature::Tickless)) {
+            source |= RTC_INIT_TICKLESS;
+        }
+        return rtc_init_preset(source, prescaler, counts, TickHz);
+    }
+
+    /** RTC_ISR for this product: the steps of rtckit_isr.h, inlined, for the listed features
+     *  only - a feature left out has no code in the ISR at all.  Stats and Tickless are part of
+     *  rtc_step_begin()/rtc_step_end() and go with what rtckit.c is compiled with.  Returns the
+     *  RTC_ISR_WAKEUP flag for the interrupt function.
+     */
+    static inline unsigned int isr()
+    {
+        unsigned int flags = rtc_step_begin();
+
+        if (flags & RTC_ISR_CONTINUE) {
+            #ifdef RTCKIT_DAYSEC
+            if constexpr (uses(Feature::DaySec)) {
+                rtc_step_daysec();
+            }
+            #endif
+            #ifdef RTCKIT_CALLBACKS
+            if constexpr (uses(Feature::Callbacks)) {
+                flags |= rtc_step_tick_handler();
+            }
+            #endif
+            #ifdef RTCKIT_LEGACY_ALARMS
+            if constexpr (uses(Feature::LegacyAlarms)) {
+                flags |= rtc_step_legacy_alarms();
+            }
+            #endif
+            #if RTCKIT_ALARM_TABLE_SIZE > 0
+            if constexpr (NumAlarms > 0) {
+                flags |= rtc_step_alarm_table();
+            }
+            #endif
+            #ifdef RTCKIT_CHECKPOINT_INTERVAL
+            if constexpr (uses(Feature::Checkpoint)) {
+                rtc_step_checkpoint();
+            }
+            #endif
+            flags = rtc_step_end(flags);
+        }
+        return flags;
+    }
+
+    /// The current epoch timestamp - rtc_get_epoch()
+    static unsigned long now()
+    {
+        return rtc_get_epoch();
+    }
+
+    /// Set the clock - rtc_set_epoch()
+    static void set(unsigned long epoch)
+    {
+        rtc_set_epoch(epoch);
+    }
+
+    #if RTCKIT_ALARM_TABLE_SIZE > 0
+    /// Arm alarm table entry Id - rtc_alarm_set()
+    template <unsigned int Id>
+    static int alarm(unsigned long when, unsigned long incr = 0)
+    {
+        static_assert(Id < NumAlarms, "alarm Id beyond NumAlarms");
+        return rtc_alarm_set(Id, when, incr);
+    }
+
+    /// Arm alarm table entry Id relative to now - rtc_alarm_set_in()
+    template <unsigned int Id>
+    static int alarm_in(unsigned long secs, unsigned long incr = 0)
+    {
+        static_assert(Id < NumAlarms, "alarm Id beyond NumAlarms");
+        return rtc_alarm_set_in(Id, secs, incr);
+    }
+
+    /// Disarm alarm table entry Id - rtc_alarm_cancel()
+    template <unsigned int Id>
+    static void cancel()
+    {
+        static_assert(Id < NumAlarms, "alarm Id beyond NumAlarms");
+        rtc_alarm_cancel(Id);
+    }
+    #endif /* if RTCKIT_ALARM_TABLE_SIZE > 0 */
+};
+
+}  // namespace rtckit
+
+/** Place Rtc::isr() on the RTC vector, as RTC_ISR - with RTCKIT_LIBRARY_PROVIDES_ISR left
+ *  undefined in rtckit.h, at namespace scope in one source file:
+ *
+ *  RTCKIT_ISR(Clock)
+ */
+#ifndef RTCKIT_LIBRARY_PROVIDES_ISR
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#define RTCKIT_PRAGMA(x) _Pragma(#x)
+#define RTCKIT_VECTOR_PRAGMA(v) RTCKIT_PRAGMA(vector=v)
+#define RTCKIT_ISR(Type) \
+    RTCKIT_VECTOR_PRAGMA(RTC_HW_VECTOR) \
+    extern "C" __interrupt void RTC_ISR(void) \
+    { \
+        if (Type::isr() & RTC_ISR_WAKEUP) { \
+            __bic_SR_register_on_exit(LPM3_bits); \
+        } \
+    }
+#elif defined(__GNUC__) && defined(__MSP430__)
+#define RTCKIT_ISR(Type) \
+    extern "C" void __attribute__ ((interrupt(RTC_HW_VECTOR))) RTC_ISR(void) \
+    { \
+        if (Type::isr() & RTC_ISR_WAKEUP) { \
+            __bic_SR_register_on_exit(LPM3_bits); \
+        } \
+    }
+#elif defined(RTCKIT_HOST_STUB)
+#define RTCKIT_ISR(Type) \
+    extern "C" void RTC_ISR(void) \
+    { \
+        if (Type::isr() & RTC_ISR_WAKEUP) { \
+            __bic_SR_register_on_exit(LPM3_bits); \
+        } \
+    }
+#endif
+#endif /* ifndef RTCKIT_LIBRARY_PROVIDES_ISR */
+
+#endif /* RTCKIT_HPP */
@@ -0,0 +1,177 @@
+/**
+  * MSP430 Real Time Clock Kit - division-free arithmetic
+  *
+  * Internal header.  The MSP430 has no divide instruction, so every 32-bit "/" or "%" in the
+  * conversion code is a call into the compiler's software divide.  The kernels here replace
+  * the constant divisors the conversions need with multiplication by a scaled reciprocal.
+  * Each one documents the input range over which it is exact.
+  *
+  * 16x16-bit multiplies go through rtc_mul16(), which drives the MPY32 hardware multiplier
+  * directly when RTCKIT_USE_MPY32 is defined on parts having one - otherwise it is plain C,
+  * which works on any compiler or host.  test/cycles.c times both on the target.
+  *
+  * @file rtckit_arith.h
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#ifndef RTCKIT_ARITH_H
+#define RTCKIT_ARITH_H
+#include "rtckit.h"
+
+#if defined(__MSP430__) || defined(__ICC430__) || defined(RTCKIT_HOST_STUB)
+#include <msp430.h>
+
+/// Interrupt masking for updates made from outside RTC_ISR
+#define RTCKIT_CRITICAL_ENTER() unsigned int rtc_saved_sr = __get_SR_register(); __disable_interrupt()
+#define RTCKIT_CRITICAL_EXIT() if (rtc_saved_sr & GIE) { __enable_interrupt(); }
+#else
+/// Built for a host (rtckit_conv.c on its own) - there is no RTC_ISR to guard against
+#define RTCKIT_CRITICAL_ENTER() do { } while (0)
+#define RTCKIT_CRITICAL_EXIT() do { } while (0)
+#endif
+
+/// 16 x 16 -> 32-bit unsigned multiply
+static inline unsigned long rtc_mul16(unsigned int a, unsigned int b)
+{
+#if defined(RTCKIT_USE_MPY32) && defined(__MSP430_HAS_MPY32__)
+    unsigned long product;
+    unsigned int gie = __get_SR_register() & GIE;
+
+    // An ISR using the multiplier would clobber the result registers.  Inside RTC_ISR - or any
+    // other ISR - interrupts are already off, and the multiply goes ahead without touching GIE.
+    if (gie) {
+        __disable_interrupt();
+    }
+    MPY = a;
+    OP2 = b;
+    product = ((unsigned long)RESHI << 16) | RESLO;
+    if (gie) {
+        __enable_interrupt();
+    }
+    return product;
+#else
+    return (unsigned long)a * b;
+#endif
+}
+
+/** (hi:lo) / d for a 64-bit dividend given as two halves, exact as long as hi < d - the
+ *  quotient then fits 32 bits.  Plain shift-and-subtract, one bit a round: it is for run-time
+ *  divisors, off any hot path, and keeps the compiler's 64-bit divide out of the build.
+ */
+static inline unsigned long rtc_div64_32(unsigned long hi, unsigned long lo, unsigned long d)
+{
+    unsigned long q = 0;
+    unsigned int i, carry;
+
+    // The masks are free on the MSP430 and keep a host's 64-bit long honest
+    lo &= 0xFFFFFFFFUL;
+    for (i = 0; i < 32; i++) {
+        carry = (hi & 0x80000000UL) != 0;
+        hi = ((hi << 1) | (lo >> 31)) & 0xFFFFFFFFUL;
+        lo = (lo << 1) & 0xFFFFFFFFUL;
+        q <<= 1;
+        if (carry || hi >= d) {
+            hi -= d;
+            q |= 1;
+        }
+    }
+    return q;
+}
+
+/** epoch / 86400, for any 32-bit epoch; the remainder (seconds of the day) goes to *sod.
+ *  The estimate (epoch >> 16) * 65536/86400 is never high and at most 2 low, so the
+ *  correction loop below runs no more than twice.  86400 = 675 << 7 keeps the product 16x16.
+ */
+static inline unsigned int rtc_div86400(unsigned long epoch, unsigned long *sod)
+{
+    unsigned int days = (unsigned int)(rtc_mul16((unsigned int)(epoch >> 16), 49710) >> 16);
+    unsigned long rem = epoch - (rtc_mul16(days, 675) << 7);
+
+    while (rem >= 86400) {
+        rem -= 86400;
+        days++;
+    }
+    *sod = rem;
+    return days;
+}
+
+/// n % 7, exact for n < 57343: n / 7 == (n * 74899) >> 19, with n * 74899 split as 16x16
+static inline unsigned int rtc_mod7(unsigned int n)
+{
+    unsigned int q = (unsigned int)((((unsigned long)n << 16) + rtc_mul16(n, 9363)) >> 19);
+
+    return n - q * 7;
+}
+
+/// n / 1461 (days in a leap cycle), exact for any 16-bit n
+static inline unsigned int rtc_div1461(unsigned int n)
+{
+    return (unsigned int)(rtc_mul16(n, 45934) >> 26);
+}
+
+/// Split seconds-of-day (< 86400) into hour, minute and second
+static inline void rtc_split_sod(unsigned long sod, struct rtc_datetime *dt)
+{
+    unsigned int secs, hour = 0, min;
+
+    if (sod >= 43200) {
+        sod -= 43200;  // Bring it into 16 bits
+        hour = 12;
+    }
+    secs = (unsigned int)sod;
+    min = (unsigned int)(rtc_mul16(secs, 37283) >> 27);   // secs / 3600, exact below 125203
+    hour += min;
+    secs -= min * 3600;
+    min = (unsigned int)(rtc_mul16(secs, 4370) >> 18);    // secs / 60, exact below 4681
+    dt->hour = hour;
+    dt->min = min;
+    dt->sec = secs - min * 60;
+}
+
+/// Leap rule good for the 1970-2106 range of an unsigned long epoch
+static inline unsigned int rtc_is_leap(unsigned int year)
+{
+    return ((year & 3) == 0 && year != 2100);
+}
+
+/// Days from Jan 1 1970 to a date - full year 1970-2106, mon 0-11, mday 1-31 - with no divides
+static inline unsigned long rtc_days_from_civil(unsigned int year, unsigned int mon, unsigned int mday)
+{
+    unsigned int leap = (year & 3) == 0 && year != 2100;
+    unsigned int leaps = (year - 1969) >> 2;  // Leap days before Jan 1 - 1972 is the first
+
+    if (year > 2100) {
+        leaps--;
+    }
+    return rtc_mul16(year - 1970, 365) + leaps + rtc_yday_before_month[leap][mon] + mday - 1;
+}
+
+/// Days since Jan 1 1970 and seconds into that day to a date - in rtckit_conv.c
+void rtc_interpret_days(unsigned int days, unsigned long sod, struct rtc_datetime *dt);
+
+#endif /* RTCKIT_ARITH_H */
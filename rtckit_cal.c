@@ -0,0 +1,147 @@
+/**
+  * MSP430 Real Time Clock Kit
+  *
+  * Calendar alarms: cron-like rules for the alarm table.  The next time a rule matches is
+  * worked out once each time its alarm triggers, from one conversion of the current date, so
+  * RTC_ISR still only ever compares rtcepoch against the head of the alarm queue.  Rules in
+  * local time go through the timezone layer in rtckit_tz.c.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include "rtckit.h"
+#include "rtckit_arith.h"
+
+/// How far ahead rtc_cal_next() looks - long enough for a Feb 29 across 2100
+#define RTC_CAL_SEARCH_DAYS (8 * 366)
+
+/// Turn a local time of day into UTC, with the offset in effect at that moment
+static unsigned long rtc_cal_to_utc(unsigned long local, long offset)
+{
+    long actual = rtc_tz_offset(local - offset, NULL);
+
+    if (actual != offset) {
+        // A DST transition lies between the search start and this day
+        actual = rtc_tz_offset(local - actual, NULL);
+    }
+    if (actual > 0 && local < (unsigned long)actual) {
+        return 0;  // Still 1969 in UTC - never after the search start
+    }
+    return local - actual;
+}
+
+unsigned long rtc_cal_next(const struct rtcCalRule *rule, unsigned long after)
+{
+    struct rtc_datetime dt;
+    unsigned long day, when, tod;
+    unsigned int n, leap, left;
+    long offset = 0;
+
+    tod = rtc_mul16(rule->hour, 3600) + rule->min * 60 + rule->sec;
+    if (rule->flags & RTC_CAL_LOCAL) {
+        offset = rtc_tz_offset(after, NULL);
+    }
+    if (offset < 0 && after < (unsigned long)-offset) {
+        day = 0;  // Local time would still be in 1969 - the search starts on Jan 1 1970
+    } else if (offset > 0 && after > 0xFFFFFFFFUL - offset) {
+        day = 0xFFFFFFFFUL;  // Local time would be past the last epoch - so is every match
+    } else {
+        day = after + offset;
+    }
+    rtc_interpret_dt(day, &dt);
+    day -= rtc_mul16(dt.hour, 3600) + dt.min * 60 + dt.sec;
+
+    for (n = 0; n < RTC_CAL_SEARCH_DAYS; ) {
+        leap = rtc_is_leap(dt.year);
+        left = rtc_yday_before_month[leap][dt.mon+1] - rtc_yday_before_month[leap][dt.mon] - dt.mday;
+        if (rule->months == 0 || (rule->months >> dt.mon) & 1) {
+            if ((rule->mdays == 0 || (rule->mdays >> (dt.mday - 1)) & 1) &&
+                (rule->wdays == 0 || (rule->wdays >> dt.wday) & 1)) {
+                when = day + tod;
+                if (rule->flags & RTC_CAL_LOCAL) {
+                    when = rtc_cal_to_utc(when, offset);
+                }
+                if (when > after) {
+                    return when;
+                }
+            }
+            if (left > 0) {
+                // Next day
+                if (day + 86400UL < day) {
+                    break;  // Ran off the end of the epoch
+                }
+                day += 86400UL;
+                dt.mday++;
+                dt.wday = (dt.wday == 6) ? 0 : dt.wday + 1;
+                n++;
+                continue;
+            }
+        }
+        // On to the 1st of the next month
+        when = day + (unsigned long)(left + 1) * 86400UL;
+        if (when < day) {
+            break;
+        }
+        day = when;
+        dt.wday = rtc_mod7(dt.wday + left + 1);
+        dt.mday = 1;
+        if (++dt.mon == 12) {
+            dt.mon = 0;
+            dt.year++;
+        }
+        n += left + 1;
+    }
+    return 0;
+}
+
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+/// Rules behind the alarms armed by rtc_alarm_set_rule(), indexed by alarm ID
+static struct rtcCalRule rtc_cal_rules[RTCKIT_ALARM_TABLE_SIZE];
+
+/// rtcAlarmRearm for rule alarms - runs from rtc_dispatch()
+static unsigned long rtc_cal_rearm(unsigned int id, unsigned long now)
+{
+    return rtc_cal_next(&rtc_cal_rules[id], now);
+}
+
+int rtc_alarm_set_rule(unsigned int id, const struct rtcCalRule *rule)
+{
+    unsigned long when;
+
+    if (id >= RTCKIT_ALARM_TABLE_SIZE) {
+        return -1;
+    }
+    when = rtc_cal_next(rule, rtc_get_epoch());
+    if (when == 0) {
+        return -1;
+    }
+    // Disarm first, so a re-arm still pending can't run from a half-written rule
+    rtc_alarm_cancel(id);
+    rtc_cal_rules[id] = *rule;
+    return rtc_alarm_set_rearm(id, when, rtc_cal_rearm);
+}
+#endif /* if RTCKIT_ALARM_TABLE_SIZE > 0 */
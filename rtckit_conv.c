@@ -0,0 +1,427 @@
+/**
+  * MSP430 Real Time Clock Kit
+  *
+  * Epoch <-> date conversion.  Nothing in here touches the RTC peripheral or includes
+  * <msp430.h> unless built for an MSP430, so this file also compiles on its own with a host
+  * compiler - to check the conversion against the C library, or to time it, off the target.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include "rtckit.h"
+#include "rtckit_arith.h"
+
+// RTC timestamp interpretation
+
+/// Function prototypes of utility helper functions
+unsigned int rtc_calculate_yday(struct tm *, unsigned long, unsigned int);
+
+/// Days elapsed before the start of each month, for common [0] and leap [1] years
+const unsigned int rtc_yday_before_month[2][13] =
+{
+    {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365},
+    {0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366}
+};
+
+/// This buffer is offered out to user functions as return value of rtc_interpret()
+static struct tm timebuf;
+
+/** Closed-form epoch to date conversion.
+ *  Days are counted from Jan 1 1968, so each 1461-day cycle starts with its leap year and
+ *  the year is found with one (reciprocal-multiply) divide and a few compares.  Day numbers
+ *  from Mar 1 2100 on are bumped by one to step over the Feb 29 that 2100 doesn't have.  The
+ *  month is found by guessing yday/32 - which is never more than one month short - and
+ *  correcting against rtc_yday_before_month[], so no part of the conversion loops over years
+ *  or months.
+ */
+void rtc_interpret_days(unsigned int days, unsigned long sod, struct rtc_datetime *dt)
+{
+    unsigned int cycle, yday, mon, year;
+    unsigned int is_leap = 0;
+
+    // Thursday, Jan 1 1970 is day 0
+    dt->wday = rtc_mod7(days + 4);
+
+    days += RTC_DAYS_1968_TO_EPOCH;
+    if (days >= RTC_DAYS_1968_TO_MAR1_2100) {
+        days++;
+    }
+    cycle = rtc_div1461(days);
+    yday = days - cycle * 1461;
+    year = 1968 + cycle * 4;
+    if (yday < 366) {
+        is_leap = 1;
+    } else if (yday < 366 + 365) {
+        yday -= 366;
+        year += 1;
+    } else if (yday < 366 + 365*2) {
+        yday -= 366 + 365;
+        year += 2;
+    } else {
+        yday -= 366 + 365*2;
+        year += 3;
+    }
+    dt->year = year;
+
+    // 2100 went through the cycle as a leap year without a Feb 29: its dates come out right
+    // from the leap table, but its true day-of-year is one less from March on.
+    dt->yday = (year == 2100 && yday > 59) ? yday - 1 : yday;
+    mon = yday >> 5;
+    if (yday >= rtc_yday_before_month[is_leap][mon+1]) {
+        mon++;
+    }
+    dt->mon = mon;
+    dt->mday = yday - rtc_yday_before_month[is_leap][mon] + 1;
+
+    rtc_split_sod(sod, dt);
+}
+
+static void rtc_interpret_dt_full(unsigned long epoch, struct rtc_datetime *dt)
+{
+    unsigned long sod;
+    unsigned int days = rtc_div86400(epoch, &sod);
+
+    rtc_interpret_days(days, sod, dt);
+}
+
+
+/// Day number and second of the day of the last epoch an unsigned long holds, Feb 7 2106 06:28:15
+#define RTC_LAST_EPOCH_DAY 49710
+#define RTC_LAST_EPOCH_SOD 23295UL
+
+/// Day number of Dec 31 2106, the last date a struct rtc_datetime is kept for
+#define RTC_LAST_DT_DAY 50403
+
+/// Days in month mon (0-11) of a common [0] or leap [1] year
+static inline unsigned int rtc_days_in_month(unsigned int is_leap, unsigned int mon)
+{
+    return rtc_yday_before_month[is_leap][mon+1] - rtc_yday_before_month[is_leap][mon];
+}
+
+/// Midnight of day number days as an epoch - 86400 = 675 << 7 keeps the multiply 16x16
+static inline unsigned long rtc_day_start(unsigned int days)
+{
+    return rtc_mul16(days, 675) << 7;
+}
+
+/** Last-day cache
+ *  Nearly every conversion falls on the same day as the one before, so the date of the last
+ *  full conversion is kept with the epoch of its midnight.  Writes are made with interrupts
+ *  masked and bump the generation; a reader that sees the generation change under it - an ISR
+ *  converting in the middle of its copy - does a full conversion instead.
+ */
+static volatile struct rtcBatch rtc_dtcache;
+static volatile unsigned int rtc_dtcache_gen;
+
+/// Cache hit/miss counters, read through rtc_cache_stats()
+static struct rtcCacheStats rtc_cstats;
+
+struct rtc_datetime * rtc_interpret_dt(unsigned long epoch, struct rtc_datetime *dt)
+{
+    unsigned int gen = rtc_dtcache_gen;
+    unsigned long sod = epoch - rtc_dtcache.day_start;
+
+    if (sod < 86400UL && rtc_dtcache.dt.mday != 0) {
+        dt->year = rtc_dtcache.dt.year;
+        dt->yday = rtc_dtcache.dt.yday;
+        dt->mon = rtc_dtcache.dt.mon;
+        dt->mday = rtc_dtcache.dt.mday;
+        dt->wday = rtc_dtcache.dt.wday;
+        if (rtc_dtcache_gen == gen) {
+            rtc_split_sod(sod, dt);
+            rtc_cstats.interpret_hits++;
+            return dt;
+        }
+    }
+
+    rtc_cstats.interpret_misses++;
+    rtc_interpret_dt_full(epoch, dt);
+
+    RTCKIT_CRITICAL_ENTER();
+    rtc_dtcache.day_start = epoch - (rtc_mul16(dt->hour, 3600) + dt->min * 60 + dt->sec);
+    rtc_dtcache.dt.year = dt->year;
+    rtc_dtcache.dt.yday = dt->yday;
+    rtc_dtcache.dt.mon = dt->mon;
+    rtc_dtcache.dt.mday = dt->mday;
+    rtc_dtcache.dt.wday = dt->wday;
+    rtc_dtcache_gen++;
+    RTCKIT_CRITICAL_EXIT();
+
+    return dt;
+}
+
+void rtc_cache_stats(struct rtcCacheStats *stats, unsigned int reset)
+{
+    RTCKIT_CRITICAL_ENTER();
+    *stats = rtc_cstats;
+    if (reset) {
+        rtc_cstats.interpret_hits = 0;
+        rtc_cstats.interpret_misses = 0;
+    }
+    RTCKIT_CRITICAL_EXIT();
+}
+
+/// Copy a struct rtc_datetime into a struct tm
+static void rtc_dt_to_tm(const struct rtc_datetime *dt, struct tm *buf)
+{
+    buf->tm_sec = dt->sec;
+    buf->tm_min = dt->min;
+    buf->tm_hour = dt->hour;
+    buf->tm_mday = dt->mday;
+    buf->tm_mon = dt->mon;
+    buf->tm_year = dt->year;
+    buf->tm_wday = dt->wday;
+    buf->tm_yday = dt->yday;
+    buf->tm_isdst = 0;
+}
+
+struct tm * rtc_interpret_r(unsigned long epoch, struct tm *buf)
+{
+    struct rtc_datetime dt;
+
+    rtc_interpret_dt(epoch, &dt);
+    rtc_dt_to_tm(&dt, buf);
+    return buf;
+}
+
+void rtc_batch_init(struct rtcBatch *batch)
+{
+    batch->dt.mday = 0;  // Nothing converted yet
+}
+
+const struct rtc_datetime * rtc_batch_next(struct rtcBatch *batch, unsigned long epoch)
+{
+    unsigned long sod = epoch - batch->day_start;
+
+    if (sod < 86400UL && batch->dt.mday != 0) {
+        // Same day as the previous epoch - only the time of day changes
+        rtc_split_sod(sod, &batch->dt);
+    } else {
+        rtc_interpret_dt(epoch, &batch->dt);
+        batch->day_start = epoch - (rtc_mul16(batch->dt.hour, 3600) + batch->dt.min * 60 + batch->dt.sec);
+    }
+    return &batch->dt;
+}
+
+void rtc_interpret_batch(const unsigned long *epochs, unsigned int n, struct tm *out)
+{
+    struct rtcBatch batch;
+
+    rtc_batch_init(&batch);
+    while (n--) {
+        rtc_dt_to_tm(rtc_batch_next(&batch, *epochs++), out++);
+    }
+}
+
+struct tm * rtc_interpret(unsigned long epoch)
+{
+    return rtc_interpret_r(epoch, &timebuf);
+}
+
+unsigned long rtc_epoch(struct tm *timebuf)
+{
+    if (timebuf == NULL || timebuf->tm_year < 1970 || timebuf->tm_year > 2106) {
+        return 0;
+    }
+    unsigned int year = timebuf->tm_year, days;
+    unsigned int is_leap = rtc_is_leap(year);
+    unsigned long sod;
+
+    if (timebuf->tm_yday > 366) {
+        timebuf->tm_yday = 0;
+    }
+    if (timebuf->tm_yday == 0 && (timebuf->tm_mday > 0 || timebuf->tm_mon > 0)) {
+        timebuf->tm_yday = rtc_calculate_yday(timebuf, 0, is_leap);
+    }
+
+    days = rtc_days_from_civil(year, 0, 1) + timebuf->tm_yday;
+    sod = (unsigned long)timebuf->tm_hour * 3600 + timebuf->tm_min * 60 + timebuf->tm_sec;
+    if (days > RTC_LAST_EPOCH_DAY || (days == RTC_LAST_EPOCH_DAY && sod > RTC_LAST_EPOCH_SOD)) {
+        return 0;  // Past Feb 7 2106 06:28:15 - it would wrap
+    }
+    return rtc_day_start(days) + sod;
+}
+
+/** mktime()-style normalization
+ *  The month is carried into the year first, then the time of day is summed in seconds and
+ *  the day of the month added to the day number of the 1st of that month, so overflow and
+ *  underflow in any field - or in several at once - are absorbed by one rtc_interpret_days().
+ *  A struct that is already in range skips all of that and only gets tm_yday and tm_wday.
+ */
+unsigned long rtc_normalize(struct tm *timebuf)
+{
+    struct rtc_datetime dt;
+    unsigned long sod, days;
+    unsigned int is_leap;
+    long secs, day;
+    int year, mon;
+
+    if (timebuf == NULL) {
+        return 0;
+    }
+    year = timebuf->tm_year;
+    mon = timebuf->tm_mon;
+    if (mon < 0 || mon > 11) {
+        year += mon / 12;
+        mon %= 12;
+        if (mon < 0) {
+            mon += 12;
+            year--;
+        }
+    }
+    if (year < 1969 || year > 2107) {
+        return 0;  // Too far out for the days to carry it back
+    }
+    is_leap = rtc_is_leap(year);
+
+    if (year > 1969 && (unsigned int)timebuf->tm_sec < 60 && (unsigned int)timebuf->tm_min < 60 &&
+        (unsigned int)timebuf->tm_hour < 24 && timebuf->tm_mday > 0 &&
+        (unsigned int)timebuf->tm_mday <= rtc_days_in_month(is_leap, mon)) {
+        // Already in range - nothing to carry
+        days = rtc_days_from_civil(year, mon, timebuf->tm_mday);
+        sod = rtc_mul16(timebuf->tm_hour, 3600) + timebuf->tm_min * 60 + timebuf->tm_sec;
+        if (days > RTC_LAST_EPOCH_DAY || (days == RTC_LAST_EPOCH_DAY && sod > RTC_LAST_EPOCH_SOD)) {
+            return 0;
+        }
+        timebuf->tm_year = year;
+        timebuf->tm_mon = mon;
+        timebuf->tm_yday = rtc_yday_before_month[is_leap][mon] + timebuf->tm_mday - 1;
+        timebuf->tm_wday = rtc_mod7((unsigned int)days + 4);
+        timebuf->tm_isdst = 0;
+        return rtc_day_start((unsigned int)days) + sod;
+    }
+
+    secs = (long)timebuf->tm_hour * 3600 + (long)timebuf->tm_min * 60 + timebuf->tm_sec;
+    if (year == 1969) {
+        day = (long)rtc_days_from_civil(1970, mon, 1) - 365;  // Both are common years
+    } else {
+        day = (long)rtc_days_from_civil(year, mon, 1);
+    }
+    day += timebuf->tm_mday - 1;
+    if (secs >= 0) {
+        day += rtc_div86400((unsigned long)secs, &sod);
+    } else {
+        day -= rtc_div86400((unsigned long)-secs, &sod);
+        if (sod > 0) {
+            sod = 86400 - sod;
+            day--;
+        }
+    }
+    if (day < 0 || day > RTC_LAST_EPOCH_DAY || (day == RTC_LAST_EPOCH_DAY && sod > RTC_LAST_EPOCH_SOD)) {
+        return 0;
+    }
+
+    rtc_interpret_days((unsigned int)day, sod, &dt);
+    rtc_dt_to_tm(&dt, timebuf);
+    return rtc_day_start((unsigned int)day) + sod;
+}
+
+unsigned long rtc_dt_epoch(const struct rtc_datetime *dt)
+{
+    unsigned long days = rtc_days_from_civil(dt->year, dt->mon, dt->mday);
+
+    return rtc_day_start((unsigned int)days) + rtc_mul16(dt->hour, 3600) + dt->min * 60 + dt->sec;
+}
+
+int rtc_add_days(struct rtc_datetime *dt, long days)
+{
+    days += (long)rtc_days_from_civil(dt->year, dt->mon, dt->mday);
+    if (days < 0 || days > RTC_LAST_DT_DAY) {
+        return -1;
+    }
+    rtc_interpret_days((unsigned int)days, rtc_mul16(dt->hour, 3600) + dt->min * 60 + dt->sec, dt);
+    return 0;
+}
+
+int rtc_add_months(struct rtc_datetime *dt, int months)
+{
+    int year = dt->year + months / 12;
+    int mon = dt->mon + months % 12;
+    unsigned int is_leap, mday = dt->mday;
+
+    if (mon > 11) {
+        mon -= 12;
+        year++;
+    } else if (mon < 0) {
+        mon += 12;
+        year--;
+    }
+    if (year < 1970 || year > 2106) {
+        return -1;
+    }
+    is_leap = rtc_is_leap(year);
+    if (mday > rtc_days_in_month(is_leap, mon)) {
+        mday = rtc_days_in_month(is_leap, mon);  // Jan 31 + 1 month is the end of February
+    }
+
+    dt->year = year;
+    dt->mon = mon;
+    dt->mday = mday;
+    dt->yday = rtc_yday_before_month[is_leap][mon] + mday - 1;
+    dt->wday = rtc_mod7((unsigned int)rtc_days_from_civil(year, mon, mday) + 4);
+    return 0;
+}
+
+unsigned long rtc_next_midnight(unsigned long epoch)
+{
+    unsigned long sod;
+
+    return rtc_day_start(rtc_div86400(epoch, &sod) + 1);
+}
+
+unsigned long rtc_start_of_week(unsigned long epoch, unsigned int first_wday)
+{
+    unsigned long sod;
+    unsigned int days = rtc_div86400(epoch, &sod), back;
+
+    if (first_wday > 6) {
+        first_wday %= 7;  // Out of range - a divide, but not on the path of a valid call
+    }
+    back = rtc_mod7(rtc_mod7(days + 4) + 7 - first_wday);
+
+    if (back > days) {
+        return 0;  // The week began in 1969
+    }
+    return rtc_day_start(days - back);
+}
+
+
+unsigned int rtc_calculate_yday(struct tm *timebuf, unsigned long latest_epoch, unsigned int is_leap)
+{
+    // latest_epoch has us at the beginning of the latest year
+    unsigned int month = timebuf->tm_mon, yday;
+
+    if (month > 12) {
+        month = 12;
+    }
+    yday = rtc_yday_before_month[is_leap][month];
+    if (timebuf->tm_mday > 0) {
+        yday += timebuf->tm_mday - 1;  // tm_mday starts at 1
+    }
+
+    return yday;
+}
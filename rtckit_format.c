@@ -0,0 +1,290 @@
+/**
+  * MSP430 Real Time Clock Kit
+  *
+  * printf-free time formatting.  Digits are written two at a time out of a 200-byte table
+  * and the few values wider than two digits are split with reciprocal multiplies, so
+  * timestamping a log line needs neither the stdio formatter nor a software divide.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include "rtckit.h"
+#include "rtckit_arith.h"
+
+/// "00" through "99"
+static const char rtc_digit_pairs[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/// Write n (0-99) as two digits
+static char * rtc_put2(char *p, unsigned int n)
+{
+    const char *pair = &rtc_digit_pairs[n << 1];
+
+    p[0] = pair[0];
+    p[1] = pair[1];
+    return p + 2;
+}
+
+/// Write n (0-999) as three digits - n*41 >> 12 is n/100 over that range
+static char * rtc_put3(char *p, unsigned int n)
+{
+    unsigned int hundreds = (n * 41) >> 12;
+
+    *p++ = '0' + hundreds;
+    return rtc_put2(p, n - hundreds * 100);
+}
+
+/// Write n (0-9999) as four digits - n*5243 >> 19 is n/100 over that range
+static char * rtc_put4(char *p, unsigned int n)
+{
+    unsigned int hundreds = (unsigned int)(rtc_mul16(n, 5243) >> 19);
+
+    p = rtc_put2(p, hundreds);
+    return rtc_put2(p, n - hundreds * 100);
+}
+
+/// Write the RTC_ISO8601_LEN characters of a timestamp, without a terminator
+static char * rtc_put_iso8601(char *p, const struct rtc_datetime *dt)
+{
+    p = rtc_put4(p, dt->year);
+    *p++ = '-';
+    p = rtc_put2(p, dt->mon + 1);
+    *p++ = '-';
+    p = rtc_put2(p, dt->mday);
+    *p++ = 'T';
+    p = rtc_put2(p, dt->hour);
+    *p++ = ':';
+    p = rtc_put2(p, dt->min);
+    *p++ = ':';
+    p = rtc_put2(p, dt->sec);
+    *p++ = 'Z';
+    return p;
+}
+
+unsigned int rtc_format_iso8601(unsigned long epoch, char *buf)
+{
+    struct rtc_datetime dt;
+    char *p;
+
+    rtc_interpret_dt(epoch, &dt);
+    p = rtc_put_iso8601(buf, &dt);
+    *p = '\0';
+
+    return p - buf;
+}
+
+unsigned int rtc_format_iso8601_batch(const unsigned long *epochs, unsigned int n, char *buf, char sep)
+{
+    struct rtcBatch batch;
+    char *p = buf;
+
+    rtc_batch_init(&batch);
+    while (n--) {
+        p = rtc_put_iso8601(p, rtc_batch_next(&batch, *epochs++));
+        *p++ = sep;
+    }
+    *p = '\0';
+
+    return p - buf;
+}
+
+/// Expand the composite conversions into their parts
+static const char * rtc_strftime_composite(char c)
+{
+    switch (c) {
+        case 'F':
+            return "%Y-%m-%d";
+        case 'T':
+            return "%H:%M:%S";
+        case 'R':
+            return "%H:%M";
+        case 'D':
+            return "%m/%d/%y";
+    }
+    return NULL;
+}
+
+/// Every field rtc_strftime() can print is in range - a stray one would index past the tables
+static int rtc_strftime_valid(const struct tm *t)
+{
+    return (unsigned int)t->tm_year <= 9999 && (unsigned int)t->tm_mon <= 11 &&
+           (unsigned int)(t->tm_mday - 1) <= 30 && (unsigned int)t->tm_hour <= 23 &&
+           (unsigned int)t->tm_min <= 59 && (unsigned int)t->tm_sec <= 60 &&
+           (unsigned int)t->tm_yday <= 365 && (unsigned int)t->tm_wday <= 6;
+}
+
+unsigned int rtc_strftime(char *buf, unsigned int size, const char *fmt, const struct tm *timebuf)
+{
+    char *p = buf, *end = buf + size;
+    const char *resume = NULL, *name;
+    char scratch[4];
+    unsigned int len, hour12;
+
+    if (size == 0 || !rtc_strftime_valid(timebuf)) {
+        return 0;
+    }
+    end--;  // Room for the terminator
+
+    for (;;) {
+        if (*fmt == '\0') {
+            if (resume == NULL) {
+                break;
+            }
+            fmt = resume;  // End of a composite conversion, back to the caller's format
+            resume = NULL;
+            continue;
+        }
+        if (*fmt != '%') {
+            if (p == end) {
+                return 0;
+            }
+            *p++ = *fmt++;
+            continue;
+        }
+
+        fmt++;
+        if (resume == NULL && (name = rtc_strftime_composite(*fmt)) != NULL) {
+            resume = fmt + 1;
+            fmt = name;
+            continue;
+        }
+
+        // Each conversion goes to scratch (numbers) or name (text), then is copied out below
+        name = scratch;
+        len = 2;
+        switch (*fmt) {
+            case 'Y':
+                rtc_put4(scratch, timebuf->tm_year);
+                len = 4;
+                break;
+            case 'y':
+                rtc_put2(scratch, timebuf->tm_year - (unsigned int)(rtc_mul16(timebuf->tm_year, 5243) >> 19) * 100);
+                break;
+            case 'm':
+                rtc_put2(scratch, timebuf->tm_mon + 1);
+                break;
+            case 'd':
+                rtc_put2(scratch, timebuf->tm_mday);
+                break;
+            case 'e':
+                rtc_put2(scratch, timebuf->tm_mday);
+                if (scratch[0] == '0') {
+                    scratch[0] = ' ';
+                }
+                break;
+            case 'H':
+                rtc_put2(scratch, timebuf->tm_hour);
+                break;
+            case 'I':
+                hour12 = timebuf->tm_hour;
+                if (hour12 > 12) {
+                    hour12 -= 12;
+                } else if (hour12 == 0) {
+                    hour12 = 12;
+                }
+                rtc_put2(scratch, hour12);
+                break;
+            case 'M':
+                rtc_put2(scratch, timebuf->tm_min);
+                break;
+            case 'S':
+                rtc_put2(scratch, timebuf->tm_sec);
+                break;
+            case 'j':
+                rtc_put3(scratch, timebuf->tm_yday + 1);
+                len = 3;
+                break;
+            case 'w':
+                scratch[0] = '0' + timebuf->tm_wday;
+                len = 1;
+                break;
+            case 'p':
+                name = (timebuf->tm_hour < 12) ? "AM" : "PM";
+                break;
+            case 'a':
+                name = dayInfo[timebuf->tm_wday].shortName;
+                len = 3;
+                break;
+            case 'A':
+                name = dayInfo[timebuf->tm_wday].longName;
+                len = 0xFFFF;
+                break;
+            case 'b':
+                name = monthInfo[timebuf->tm_mon].shortName;
+                len = 3;
+                break;
+            case 'B':
+                name = monthInfo[timebuf->tm_mon].longName;
+                len = 0xFFFF;
+                break;
+            case 'n':
+                scratch[0] = '\n';
+                len = 1;
+                break;
+            case 't':
+                scratch[0] = '\t';
+                len = 1;
+                break;
+            case '%':
+                scratch[0] = '%';
+                len = 1;
+                break;
+            case '\0':
+                // A lone % at the end of the format
+                scratch[0] = '%';
+                len = 1;
+                fmt--;
+                break;
+            default:
+                // Anything not understood is copied as it is
+                scratch[0] = '%';
+                scratch[1] = *fmt;
+                break;
+        }
+        fmt++;
+
+        // len 0xFFFF copies up to the name's terminator
+        while (len-- && *name != '\0') {
+            if (p == end) {
+                return 0;
+            }
+            *p++ = *name++;
+        }
+    }
+
+    *p = '\0';
+    return p - buf;
+}
@@ -0,0 +1,155 @@
+/**
+  * MSP430 Real Time Clock Kit - timebase backends
+  *
+  * Internal header, for rtckit.c and RTCKIT_ISR() in rtckit.hpp.  RTC_ISR and the code under
+  * rtc_init() reach the hardware through the RTC_HW_* macros here, one set per RTCKIT_BACKEND:
+  *
+  *   RTC_HW_VECTOR       interrupt vector RTC_ISR is placed on
+  *   RTC_HW_DUE()        in RTC_ISR: true if it was entered for a tick (reading it may clear it)
+  *   RTC_HW_CNT          counts into the running period, 0 where there is no counter to read
+  *   RTC_HW_PENDING()    a tick RTC_ISR hasn't been run for yet
+  *   RTC_HW_CLEAR()      forget that tick
+  *   RTC_HW_SETUP(s, b)  select clock source s and prescaler bits b
+  *   RTC_HW_RESTART()    start the period over from 0
+  *   RTC_HW_IRQ_ON()     enable the tick interrupt
+  *   RTC_HW_PRESCALERS   { bits, divider } pairs for rtc_prescalers[], smallest divider first
+  *   RTC_HW_HAS_MOD      1 if the period length is programmed through RTC_HW_MOD
+  *   RTC_HW_MOD_BUFFERED 1 if a RTC_HW_MOD write only takes effect from the next period or
+  *                       RTC_HW_RESTART(), 0 if it applies to the running one
+  *
+  * @file rtckit_hw.h
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#ifndef RTCKIT_HW_H
+#define RTCKIT_HW_H
+#include <msp430.h>
+#include "rtckit.h"
+
+#if RTCKIT_BACKEND == RTCKIT_BACKEND_RTC
+// RTC counter of the FR4xxx/FR2xxx parts: RTCMOD is buffered until the counter rolls over
+
+#if defined(__MSP430_HAS_RTC__)
+#define RTC_HW_VECTOR RTC_VECTOR
+#endif
+#define RTC_HW_DUE() (RTCIV & RTCIV_RTCIF)
+#define RTC_HW_CNT RTCCNT
+#define RTC_HW_MOD RTCMOD
+#define RTC_HW_HAS_MOD 1
+#define RTC_HW_MOD_BUFFERED 1
+#define RTC_HW_PENDING() (RTCCTL & RTCIF)
+#define RTC_HW_CLEAR() (RTCCTL &= ~RTCIF)
+#define RTC_HW_SETUP(src, bits) (RTCCTL = (src) | (bits))
+#define RTC_HW_RESTART() (RTCCTL |= RTCSR)  // Also reloads RTCMOD right away
+#define RTC_HW_IRQ_ON() (RTCCTL |= RTCIE)
+#define RTC_HW_PRESCALERS \
+    { RTCPS__1, 1 }, { RTCPS__10, 10 }, { RTCPS__16, 16 }, { RTCPS__64, 64 }, \
+    { RTCPS__100, 100 }, { RTCPS__256, 256 }, { RTCPS__1000, 1000 }, { RTCPS__1024, 1024 }
+
+#elif RTCKIT_BACKEND == RTCKIT_BACKEND_TIMER_A
+// Timer_A in up mode, TAxR counting from 0 up to and including TAxCCR0 - which, unlike RTCMOD,
+// takes effect as soon as it is written.  TAIFG, not the TAxCCR0 CCIFG, marks the rollover:
+// CCIFG is set a count early, on reaching TAxCCR0.  The prescaler bits are ID in the low byte
+// and IDEX in the high one.
+
+#ifndef RTCKIT_TIMER_A
+#define RTCKIT_TIMER_A 1
+#endif
+#define RTC_HW_TA_REG(n, reg) TA ## n ## reg
+#define RTC_HW_TA(n, reg) RTC_HW_TA_REG(n, reg)
+#define RTC_HW_TA_VECTOR_N(n) TIMER ## n ## _A1_VECTOR
+#define RTC_HW_TA_VECTOR(n) RTC_HW_TA_VECTOR_N(n)
+
+#define RTC_HW_VECTOR RTC_HW_TA_VECTOR(RTCKIT_TIMER_A)
+#define RTC_HW_DUE() (RTC_HW_TA(RTCKIT_TIMER_A, IV) == TAIV__TAIFG)
+#define RTC_HW_CNT RTC_HW_TA(RTCKIT_TIMER_A, R)
+#define RTC_HW_MOD RTC_HW_TA(RTCKIT_TIMER_A, CCR0)
+#define RTC_HW_HAS_MOD 1
+#define RTC_HW_MOD_BUFFERED 0
+#define RTC_HW_PENDING() (RTC_HW_TA(RTCKIT_TIMER_A, CTL) & TAIFG)
+#define RTC_HW_CLEAR() (RTC_HW_TA(RTCKIT_TIMER_A, CTL) &= ~TAIFG)
+#define RTC_HW_SETUP(src, bits) \
+    (RTC_HW_TA(RTCKIT_TIMER_A, CTL) = TACLR, RTC_HW_TA(RTCKIT_TIMER_A, EX0) = (bits) >> 8, \
+     RTC_HW_TA(RTCKIT_TIMER_A, CTL) = ((src) & TASSEL_3) | ((bits) & ID_3) | MC__UP)
+#define RTC_HW_RESTART() (RTC_HW_TA(RTCKIT_TIMER_A, CTL) |= TACLR)
+#define RTC_HW_IRQ_ON() (RTC_HW_TA(RTCKIT_TIMER_A, CTL) |= TAIE)
+#define RTC_HW_PRESCALERS \
+    { ID__1, 1 }, { ID__2, 2 }, { ID__4, 4 }, { ID__8, 8 }, \
+    { ID__8 | (TAIDEX_1 << 8), 16 }, { ID__8 | (TAIDEX_3 << 8), 32 }, { ID__8 | (TAIDEX_7 << 8), 64 }
+
+#if RTCKIT_TIMER_A == 0 && defined(RTCKIT_VLO_CALIBRATION)
+#error "rtc_vlo_calibrate() measures with Timer0_A3 - give the backend another RTCKIT_TIMER_A"
+#endif
+
+#elif RTCKIT_BACKEND == RTCKIT_BACKEND_WDT
+// Watchdog interval timer: fixed intervals of 64 to 32768 source cycles, and no counter to
+// read.  The prescaler is the interval; rtc_subtick counts cycles into the second instead of
+// ticks, so the seconds come out right on average whatever the interval.
+
+#define RTC_HW_VECTOR WDT_VECTOR
+#define RTC_HW_DUE() 1  // WDTIFG is cleared on entry
+#define RTC_HW_CNT 0
+#define RTC_HW_HAS_MOD 0
+#define RTC_HW_PENDING() (SFRIFG1 & WDTIFG)
+#define RTC_HW_CLEAR() (SFRIFG1 &= ~WDTIFG)
+#define RTC_HW_SETUP(src, bits) (WDTCTL = WDTPW | WDTHOLD | WDTTMSEL | WDTCNTCL | (src) | (bits))
+#define RTC_HW_RESTART() (WDTCTL = WDTPW | WDTCNTCL | (WDTCTL & (WDTSSEL_3 | WDTTMSEL | WDTIS_7)))
+#define RTC_HW_IRQ_ON() (SFRIE1 |= WDTIE)
+#define RTC_HW_PRESCALERS \
+    { WDTIS__64, 64 }, { WDTIS__512, 512 }, { WDTIS__8192, 8192 }, { WDTIS__32K, 32768U }
+
+#elif RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+// RTC_C calendar mode of the FR5xxx/FR6xxx parts: the hardware keeps the date, rtcepoch is
+// counted along on RTCRDYIFG once a second, and RTCPS - RT1PS:RT0PS - gives the 32768 counts
+// into it.  Setting up and setting the time go through the calendar code in rtckit.c.
+
+#define RTC_HW_VECTOR RTC_VECTOR
+#define RTC_HW_DUE() (RTCIV == RTCIV_RTCRDYIFG)
+#define RTC_HW_CNT (RTCPS & 0x7FFF)
+#define RTC_HW_HAS_MOD 0
+#define RTC_HW_PENDING() (RTCCTL0_L & RTCRDYIFG)
+#define RTC_HW_CLEAR() (RTCCTL0_H = RTCKEY_H, RTCCTL0_L &= ~RTCRDYIFG, RTCCTL0_H = 0)
+#define RTC_HW_PRESCALERS { 0, 1 }
+
+#else
+#error "Unknown RTCKIT_BACKEND"
+#endif
+
+#if RTCKIT_BACKEND == RTCKIT_BACKEND_WDT || RTCKIT_BACKEND == RTCKIT_BACKEND_RTC_C
+#ifdef RTCKIT_TICKLESS
+#error "RTCKIT_TICKLESS needs a programmable period - the RTC or Timer_A backend"
+#endif
+#ifdef RTCKIT_VLO_CALIBRATION
+#error "RTCKIT_VLO_CALIBRATION needs a programmable period - the RTC or Timer_A backend"
+#endif
+#endif
+#if defined(RTCKIT_LPM35) && RTCKIT_BACKEND != RTCKIT_BACKEND_RTC
+#error "RTCKIT_LPM35 needs the RTC backend"
+#endif
+
+#endif /* RTCKIT_HW_H */
@@ -0,0 +1,557 @@
+/**
+  * MSP430 Real Time Clock Kit - RTC_ISR in steps
+  *
+  * Internal header, for rtckit.c and rtckit.hpp.  RTC_ISR's work is kept here as static inline
+  * steps over rtckit.c's own state, so the RTC_ISR rtckit.c compiles and the one RTCKIT_ISR()
+  * puts together from a product's features both come out as a single function: a plain tick
+  * makes no calls.  Only work a tick doesn't always have - a due alarm-table entry, a periodic
+  * legacy alarm, a checkpoint - calls back into rtckit.c.
+  *
+  * rtc_step_begin() comes first; only with RTC_ISR_CONTINUE in what it returns do the feature
+  * steps follow, ORing into it, and rtc_step_end() last.  The interrupt function itself wakes
+  * the chip when RTC_ISR_WAKEUP is set in the end.  Each feature step exists only with its
+  * RTCKIT_* define.  Nothing here is for application code to touch.
+  *
+  * @file rtckit_isr.h
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+#ifndef RTCKIT_ISR_H
+#define RTCKIT_ISR_H
+#include <msp430.h>
+#include "rtckit.h"
+#include "rtckit_arith.h"
+#include "rtckit_hw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// What the steps pass on to the interrupt function
+#define RTC_ISR_CONTINUE 0x0001
+#define RTC_ISR_WAKEUP   0x0002
+
+/// RTC_ISR's state - defined and documented in rtckit.c
+extern volatile unsigned int rtc_seq;
+extern unsigned int rtc_counts_per_sec;
+extern unsigned int rtc_counts_per_tick;
+extern unsigned int rtc_tick_hz;
+extern volatile unsigned int rtc_subtick;
+#if RTCKIT_BACKEND == RTCKIT_BACKEND_WDT
+extern unsigned int rtc_tick_step;
+#define RTC_TICK_STEP rtc_tick_step
+#else
+#define RTC_TICK_STEP 1
+#endif
+#ifdef RTCKIT_TICKLESS
+extern volatile unsigned int rtc_tickless_period;
+extern unsigned int rtc_tickless_max;
+extern volatile int rtc_slew_applied;
+#endif
+extern volatile unsigned int rtc_trim_frac;
+extern volatile unsigned long rtc_trim_acc;
+extern volatile unsigned int rtc_trim_extra;
+extern volatile unsigned int rtc_cnt_offset;
+extern volatile long rtc_slew;
+extern unsigned int rtc_slew_step;
+extern volatile unsigned char rtc_mod_dirty;
+
+#ifdef RTCKIT_DAYSEC
+extern volatile unsigned long rtc_daysec_epoch;
+#endif
+
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+extern volatile struct rtcAlarm rtc_alarms[RTCKIT_ALARM_TABLE_SIZE];
+extern volatile unsigned char rtc_alarm_queue[RTCKIT_ALARM_TABLE_SIZE];
+extern volatile unsigned char rtc_alarm_queued;
+
+/// Trigger the alarm-table entries due at "now" and move them on - nonzero if any fired
+int rtc_alarm_service(unsigned long now);
+#endif
+
+#if defined(RTCKIT_LEGACY_ALARMS) || RTCKIT_ALARM_TABLE_SIZE > 0
+/// Late-alarm policy of an alarm and the occurrences it has missed - see rtc_alarm_policy()
+struct rtcAlarmState
+{
+    unsigned int missed;
+    unsigned char policy;
+};
+#ifdef RTCKIT_LEGACY_ALARMS
+extern volatile struct rtcAlarmState rtc_legacy_state[2];
+#endif
+
+/// Next trigger time of a periodic alarm that triggered at "now", by its policy
+unsigned long rtc_alarm_advance(unsigned long when, unsigned long incr, unsigned long now,
+                                volatile struct rtcAlarmState *st);
+#endif
+
+#ifdef RTCKIT_CALLBACKS
+/// A registered handler and its RTC_HANDLER_ flags
+struct rtcHandlerEntry
+{
+    rtcHandler fn;
+    unsigned int flags;
+};
+
+extern volatile struct rtcHandlerEntry rtc_tick_handler;
+#ifdef RTCKIT_LEGACY_ALARMS
+extern volatile struct rtcHandlerEntry rtc_legacy_handlers[2];
+#endif
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+extern volatile struct rtcHandlerEntry rtc_alarm_handlers[RTCKIT_ALARM_TABLE_SIZE];
+#endif
+
+/// Events waiting for rtc_dispatch() - RTC_ISR only writes rtc_pending_head, rtc_dispatch() only rtc_pending_tail
+struct rtcPendingEvent
+{
+    unsigned long epoch;
+    unsigned char event;
+};
+
+extern volatile struct rtcPendingEvent rtc_pending[RTCKIT_PENDING_QUEUE_SIZE];
+extern volatile unsigned char rtc_pending_head, rtc_pending_tail;
+#endif /* ifdef RTCKIT_CALLBACKS */
+
+#ifdef RTCKIT_CHECKPOINT_INTERVAL
+/// Copy of the live variables, written to FRAM every RTCKIT_CHECKPOINT_INTERVAL seconds
+struct rtcCheckpoint
+{
+    unsigned int magic;    /* RTCKIT_CHECKPOINT_MAGIC once completely written */
+    unsigned int clean;    /* Taken on demand by rtc_checkpoint()              */
+    unsigned long epoch;
+    #ifdef RTCKIT_LEGACY_ALARMS
+    unsigned long alarm0;
+    unsigned long alarm0_incr;
+    unsigned long alarm1;
+    unsigned long alarm1_incr;
+    #endif
+    #if RTCKIT_ALARM_TABLE_SIZE > 0
+    struct rtcAlarm alarms[RTCKIT_ALARM_TABLE_SIZE];
+    unsigned char queue[RTCKIT_ALARM_TABLE_SIZE];
+    unsigned char queued;
+    #endif
+};
+#define RTCKIT_CHECKPOINT_MAGIC 0x52C4
+
+extern struct rtcCheckpoint rtc_ckpt;
+
+/// Copy the live variables to the checkpoint, with interrupts already disabled
+void rtc_checkpoint_save(unsigned int clean);
+#endif
+
+#ifdef RTCKIT_STATS
+/// Counters behind rtc_stats() - all but the cache ones are only written by RTC_ISR
+extern volatile struct rtcStats rtc_st;
+#define RTCKIT_STAT_INC(f) (rtc_st.f++)
+#ifdef RTCKIT_STATS_TIMER
+/// RTCKIT_STATS_TIMER on entry to RTC_ISR - kept here, as the ISR may be put together from steps
+extern unsigned int rtc_isr_t0;
+#define RTCKIT_STAT_ISR_ENTER() do { rtc_isr_t0 = RTCKIT_STATS_TIMER; rtc_st.isr_entries++; } while (0)
+#define RTCKIT_STAT_ISR_EXIT() do { \
+        unsigned int rtc_isr_t = RTCKIT_STATS_TIMER - rtc_isr_t0; \
+        if (rtc_isr_t > rtc_st.isr_cycles_max) { rtc_st.isr_cycles_max = rtc_isr_t; } \
+    } while (0)
+#else
+#define RTCKIT_STAT_ISR_ENTER() rtc_st.isr_entries++
+#define RTCKIT_STAT_ISR_EXIT() ((void)0)
+#endif
+#else
+#define RTCKIT_STAT_INC(f) ((void)0)
+#define RTCKIT_STAT_ISR_ENTER() ((void)0)
+#define RTCKIT_STAT_ISR_EXIT() ((void)0)
+#endif /* ifdef RTCKIT_STATS */
+// Helpers the steps share with the rest of rtckit.c
+
+/// The counter runs on its own clock, not MCLK - read it until two reads agree
+static inline unsigned int rtc_read_cnt(void)
+{
+    unsigned int cnt;
+
+    do {
+        cnt = RTC_HW_CNT;
+    } while (cnt != RTC_HW_CNT);
+    return cnt;
+}
+#ifdef RTCKIT_DAYSEC
+/** Bring a day/second-of-day pair standing for base forward to epoch
+ *  Under a day's difference this is an add and one carry; otherwise - rtcepoch set back, or far
+ *  ahead, by user code - the pair is worked out afresh.
+ */
+static inline unsigned long rtc_daysec_advance(unsigned long epoch, unsigned long base, unsigned int *day,
+                                               unsigned long sod)
+{
+    unsigned long delta = epoch - base;
+
+    if (delta >= 86400UL) {
+        *day = rtc_div86400(epoch, &sod);
+        return sod;
+    }
+    sod += delta;
+    if (sod >= 86400UL) {
+        sod -= 86400UL;
+        (*day)++;
+    }
+    return sod;
+}
+#endif
+
+#if RTC_HW_HAS_MOD
+/** Extra counts to add to a period of the given number of seconds
+ *  Adds the fraction owed for those seconds to the accumulator and takes out the whole counts.
+ */
+static inline unsigned int rtc_trim(unsigned int period)
+{
+    unsigned long acc = rtc_trim_acc + (unsigned long)rtc_trim_frac * period;
+
+    rtc_trim_extra = (unsigned int)(acc >> 16);
+    rtc_trim_acc = acc & 0xFFFF;
+    return rtc_trim_extra;
+}
+#endif /* if RTC_HW_HAS_MOD */
+
+#if RTCKIT_BACKEND != RTCKIT_BACKEND_RTC_C
+/// Take up to max counts of rtc_adjtime() slew for the next period - positive shortens it
+static inline int rtc_slew_take(unsigned int max)
+{
+    long s = rtc_slew;
+
+    if (s > (long)max) {
+        s = max;
+    } else if (s < -(long)max) {
+        s = -(long)max;
+    }
+    rtc_slew -= s;
+    return (int)s;
+}
+#endif
+
+#if RTC_HW_HAS_MOD
+/** Is the period rtc_mod_update() programs now the last tick of a second?
+ *  sub is the tick that has just started running.  A buffered RTC_HW_MOD is for the tick after
+ *  it; otherwise the write takes effect in the tick itself.
+ */
+static inline unsigned int rtc_mod_is_last(unsigned int sub)
+{
+    #if RTC_HW_MOD_BUFFERED
+    return rtc_tick_hz == 1 || sub + 2 == rtc_tick_hz;
+    #else
+    return sub + 1 == rtc_tick_hz;
+    #endif
+}
+
+/** Program RTC_HW_MOD, outside tickless mode - see rtc_mod_is_last() for which period
+ *  The last tick of each second carries the trim and the rtc_adjtime() slew; the others get the
+ *  plain rtc_counts_per_tick back.  RTC_HW_MOD is only written when that changes anything.
+ */
+static inline void rtc_mod_update(unsigned int last)
+{
+    unsigned int mod;
+
+    if (last) {
+        mod = rtc_counts_per_tick + rtc_trim(1) - rtc_slew_take(rtc_slew_step) - 1;
+        if (mod != rtc_counts_per_tick - 1 || rtc_mod_dirty) {
+            RTC_HW_MOD = mod;
+            rtc_mod_dirty = (mod != rtc_counts_per_tick - 1);
+        }
+    } else if (rtc_mod_dirty) {
+        RTC_HW_MOD = rtc_counts_per_tick - 1;
+        rtc_mod_dirty = 0;
+    }
+}
+#endif /* if RTC_HW_HAS_MOD */
+
+#ifdef RTCKIT_TICKLESS
+/// Seconds from "now" until the next thing RTC_ISR has to do - at least 1, at most rtc_tickless_max
+static inline unsigned int rtc_tickless_gap(unsigned long now)
+{
+    unsigned long next = now + rtc_tickless_max;
+
+    if (rtc_status & RTC_TICK_DOES_WAKEUP) {
+        return 1;
+    }
+    #ifdef RTCKIT_LEGACY_ALARMS
+    if ((rtcalarm0 > 0 && rtcalarm0 <= now) || (rtcalarm1 > 0 && rtcalarm1 <= now)) {
+        return 1;  // Overdue - RTC_ISR picks it up on the next tick
+    }
+    if (rtcalarm0 > now && rtcalarm0 < next) {
+        next = rtcalarm0;
+    }
+    if (rtcalarm1 > now && rtcalarm1 < next) {
+        next = rtcalarm1;
+    }
+    #endif
+    #ifdef RTCKIT_CHECKPOINT_INTERVAL
+    if (rtc_ckpt.epoch + RTCKIT_CHECKPOINT_INTERVAL > now &&
+        rtc_ckpt.epoch + RTCKIT_CHECKPOINT_INTERVAL < next) {
+        next = rtc_ckpt.epoch + RTCKIT_CHECKPOINT_INTERVAL;
+    }
+    #endif
+    #if RTCKIT_ALARM_TABLE_SIZE > 0
+    if (rtc_alarm_queued > 0) {
+        unsigned long when = rtc_alarms[rtc_alarm_queue[0]].when;
+        if (when <= now) {
+            return 1;  // Overdue - RTC_ISR picks it up on the next tick
+        }
+        if (when < next) {
+            next = when;
+        }
+    }
+    #endif
+    return (unsigned int)(next - now);
+}
+
+/** Restart the RTC counter for a period ending at the next event after rtcepoch.
+ *  gone is the number of counts of the current second that have already elapsed; the new period
+ *  is shortened by that much so it still ends on a whole-second boundary.
+ */
+static inline void rtc_tickless_program(unsigned int gone)
+{
+    unsigned int period = rtc_tickless_gap(rtcepoch);
+    unsigned int room = period * rtc_counts_per_sec - gone;
+    unsigned int max = rtc_slew_step * period;
+
+    // The slew is taken out of the last second of the period: keep it to half a second
+    if (max > rtc_counts_per_sec / 2) {
+        max = rtc_counts_per_sec / 2;
+    }
+    if (max > room / 2) {
+        max = room / 2;
+    }
+    rtc_slew_applied = rtc_slew_take(max);
+    RTC_HW_MOD = room + rtc_trim(period) - rtc_slew_applied - 1;
+    RTC_HW_RESTART();  // Takes up RTC_HW_MOD right away, not at the end of the running period
+    rtc_cnt_offset = gone;
+    rtc_tickless_period = period;
+}
+#endif /* ifdef RTCKIT_TICKLESS */
+
+#ifdef RTCKIT_CALLBACKS
+/// Find the handler slot for an event, NULL if there is none
+static inline volatile struct rtcHandlerEntry * rtc_handler_slot(unsigned int event)
+{
+    if (event == RTC_EVENT_TICK) {
+        return &rtc_tick_handler;
+    }
+    #ifdef RTCKIT_LEGACY_ALARMS
+    if (event == RTC_EVENT_ALARM0 || event == RTC_EVENT_ALARM1) {
+        return &rtc_legacy_handlers[event - RTC_EVENT_ALARM0];
+    }
+    #endif
+    #if RTCKIT_ALARM_TABLE_SIZE > 0
+    if (event < RTCKIT_ALARM_TABLE_SIZE) {
+        return &rtc_alarm_handlers[event];
+    }
+    #endif
+    return NULL;
+}
+/** Hand an event to its handler, from RTC_ISR
+ *  An RTC_HANDLER_IN_ISR handler runs right here; any other is queued for rtc_dispatch().
+ *  A full queue drops the event and sets RTC_DISPATCH_OVERFLOW - the ISR never waits.
+ *
+ * @param[out] 1 if an event was queued and the main loop needs waking up
+ */
+static inline int rtc_event(unsigned int event, unsigned long epoch)
+{
+    volatile struct rtcHandlerEntry *slot = rtc_handler_slot(event);
+    unsigned char head, next;
+    rtcHandler fn;
+
+    if (slot == NULL || (fn = slot->fn) == NULL) {
+        return 0;
+    }
+    if (slot->flags & RTC_HANDLER_IN_ISR) {
+        fn(event, epoch);
+        return 0;
+    }
+
+    head = rtc_pending_head;
+    next = (head + 1 == RTCKIT_PENDING_QUEUE_SIZE) ? 0 : head + 1;
+    if (next == rtc_pending_tail) {
+        rtc_status |= RTC_DISPATCH_OVERFLOW;
+        return 0;
+    }
+    rtc_pending[head].event = event;
+    rtc_pending[head].epoch = epoch;
+    rtc_pending_head = next;
+    return 1;
+}
+#endif /* ifdef RTCKIT_CALLBACKS */
+
+// The steps
+
+/** Everything up to rtcepoch.  Without RTC_ISR_CONTINUE that was all - not a tick, or one
+ *  inside the second.  The wakeup itself is left to the ISR: __bic_SR_register_on_exit() only
+ *  reaches the SR the interrupt saved from the interrupt function's own frame.
+ */
+static inline unsigned int rtc_step_begin(void)
+{
+    unsigned int flags = 0;
+
+    RTCKIT_STAT_ISR_ENTER();
+    if (!RTC_HW_DUE()) {
+        RTCKIT_STAT_ISR_EXIT();
+        return 0;
+    }
+    rtc_seq++;
+    rtc_cnt_offset = 0;
+    if (rtc_tick_hz > 1 && (rtc_subtick += RTC_TICK_STEP) < rtc_tick_hz) {
+        // A tick inside the second - rtcepoch and everything driven by it wait for the last one
+        rtc_status |= RTC_SUBTICK;
+        #if RTC_HW_HAS_MOD
+        rtc_mod_update(rtc_mod_is_last(rtc_subtick));
+        #endif
+        if (rtc_status & RTC_SUBTICK_DOES_WAKEUP) {
+            flags = RTC_ISR_WAKEUP;
+            RTCKIT_STAT_INC(wakeups);
+        }
+        RTCKIT_STAT_ISR_EXIT();
+        return flags;
+    }
+    #if RTCKIT_BACKEND == RTCKIT_BACKEND_WDT
+    {
+        // The cycles past the second belong to the next one.  There's no period to slew:
+        // rtc_adjtime() moves the cycle count instead, back by no more than it holds.
+        int slew;
+
+        rtc_subtick -= rtc_tick_hz;
+        slew = rtc_slew_take(rtc_slew_step);
+        if (slew < 0 && (unsigned int)-slew > rtc_subtick) {
+            rtc_slew += slew + (int)rtc_subtick;
+            slew = -(int)rtc_subtick;
+        }
+        rtc_subtick += slew;
+    }
+    #else
+    rtc_subtick = 0;
+    #endif
+    rtc_status |= RTC_TICK;
+    #ifdef RTCKIT_TICKLESS
+    if (rtc_status & RTC_TICKLESS) {
+        rtcepoch += rtc_tickless_period;
+    } else
+    #endif
+    {
+        rtcepoch++;
+        #if RTC_HW_HAS_MOD
+        rtc_mod_update(rtc_mod_is_last(0));
+        #endif
+    }
+    return (rtc_status & RTC_TICK_DOES_WAKEUP) ? RTC_ISR_CONTINUE | RTC_ISR_WAKEUP : RTC_ISR_CONTINUE;
+}
+
+#ifdef RTCKIT_DAYSEC
+static inline void rtc_step_daysec(void)
+{
+    unsigned int day = rtc_day;
+
+    rtc_sod = rtc_daysec_advance(rtcepoch, rtc_daysec_epoch, &day, rtc_sod);
+    rtc_day = day;
+    rtc_daysec_epoch = rtcepoch;
+}
+#endif
+
+#ifdef RTCKIT_CALLBACKS
+static inline unsigned int rtc_step_tick_handler(void)
+{
+    return rtc_event(RTC_EVENT_TICK, rtcepoch) ? RTC_ISR_WAKEUP : 0;
+}
+#endif
+
+#ifdef RTCKIT_LEGACY_ALARMS
+static inline unsigned int rtc_step_legacy_alarms(void)
+{
+    unsigned int flags = 0;
+
+    if (rtcalarm0 > 0 && rtcepoch >= rtcalarm0) {
+        rtc_status |= RTCALARM_0_TRIGGERED;
+        RTCKIT_STAT_INC(alarms_fired);
+        #ifdef RTCKIT_CALLBACKS
+        rtc_event(RTC_EVENT_ALARM0, rtcepoch);
+        #endif
+        if (rtcalarm0_incr > 0) {
+            rtcalarm0 = rtc_alarm_advance(rtcalarm0, rtcalarm0_incr, rtcepoch, &rtc_legacy_state[0]);
+        } else {
+            rtcalarm0 = 0;
+        }
+        flags = RTC_ISR_WAKEUP;
+    }
+    if (rtcalarm1 > 0 && rtcepoch >= rtcalarm1) {
+        rtc_status |= RTCALARM_1_TRIGGERED;
+        RTCKIT_STAT_INC(alarms_fired);
+        #ifdef RTCKIT_CALLBACKS
+        rtc_event(RTC_EVENT_ALARM1, rtcepoch);
+        #endif
+        if (rtcalarm1_incr > 0) {
+            rtcalarm1 = rtc_alarm_advance(rtcalarm1, rtcalarm1_incr, rtcepoch, &rtc_legacy_state[1]);
+        } else {
+            rtcalarm1 = 0;
+        }
+        flags = RTC_ISR_WAKEUP;
+    }
+    return flags;
+}
+#endif /* ifdef RTCKIT_LEGACY_ALARMS */
+
+#if RTCKIT_ALARM_TABLE_SIZE > 0
+static inline unsigned int rtc_step_alarm_table(void)
+{
+    if (rtc_alarm_queued > 0 && rtcepoch >= rtc_alarms[rtc_alarm_queue[0]].when) {
+        rtc_alarm_service(rtcepoch);
+        return RTC_ISR_WAKEUP;
+    }
+    return 0;
+}
+#endif
+
+#ifdef RTCKIT_CHECKPOINT_INTERVAL
+static inline void rtc_step_checkpoint(void)
+{
+    if (rtcepoch - rtc_ckpt.epoch >= RTCKIT_CHECKPOINT_INTERVAL) {
+        rtc_checkpoint_save(0);
+    }
+}
+#endif
+
+/// The next tickless period; passes the flags on for the ISR to wake the chip with
+static inline unsigned int rtc_step_end(unsigned int flags)
+{
+    #ifdef RTCKIT_TICKLESS
+    if (rtc_status & RTC_TICKLESS) {
+        rtc_tickless_program(rtc_read_cnt());
+    }
+    #endif
+    if (flags & RTC_ISR_WAKEUP) {
+        RTCKIT_STAT_INC(wakeups);
+    }
+    RTCKIT_STAT_ISR_EXIT();
+    return flags;
+}
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTCKIT_ISR_H */
@@ -0,0 +1,294 @@
+/**
+  * MSP430 Real Time Clock Kit
+  *
+  * Timestamp log: records in a FRAM ring, stamped with a whole epoch once per block and with
+  * one- or two-byte differences in between, so a stamp costs 1-2 bytes instead of 4.  FRAM
+  * write protection is lifted once per rtc_log_write(), however many records it carries.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include <string.h>
+#include "rtckit.h"
+#include "rtckit_arith.h"
+
+/// Block layout: record count, then the first stamp, then the differences, then the data
+#define RTC_LOG_HDR(log) (((log)->flags & RTC_LOG_TICKS) ? 7 : 5)
+#define RTC_LOG_WIDTH(log) (((log)->flags & RTC_LOG_DELTA16) ? 2 : 1)
+
+#if defined(PFWP) && defined(DFWP)
+#define RTC_LOG_FRWP (PFWP | DFWP)   // The log may be in main or information FRAM
+#elif defined(DFWP)
+#define RTC_LOG_FRWP DFWP
+#endif
+
+/// Lift FRAM write protection, returning the previous setting for rtc_log_protect()
+static unsigned int rtc_log_unprotect(void)
+{
+    #ifdef RTC_LOG_FRWP
+    unsigned int prot = SYSCFG0 & 0x00FF;
+
+    SYSCFG0 = FRWPPW | (prot & ~RTC_LOG_FRWP);
+    return prot;
+    #else
+    return 0;
+    #endif
+}
+
+static void rtc_log_protect(unsigned int prot)
+{
+    #ifdef RTC_LOG_FRWP
+    SYSCFG0 = FRWPPW | prot;
+    #else
+    (void)prot;
+    #endif
+}
+
+static unsigned char * rtc_log_block(const struct rtcLog *log, unsigned int block)
+{
+    return log->buf + (unsigned long)block * log->block_size;
+}
+
+static unsigned int rtc_log_next(const struct rtcLog *log, unsigned int block)
+{
+    return (block + 1 < log->nblocks) ? block + 1 : 0;
+}
+
+/// Stamp of record i of a block, given the stamp of record i-1
+static void rtc_log_decode(const struct rtcLog *log, const unsigned char *blk, unsigned int i,
+                           unsigned long *epoch, unsigned int *ticks)
+{
+    const unsigned char *p;
+    unsigned long t;
+    unsigned int d;
+
+    if (i == 0) {
+        *epoch = (unsigned long)blk[1] | ((unsigned long)blk[2] << 8) |
+                 ((unsigned long)blk[3] << 16) | ((unsigned long)blk[4] << 24);
+        *ticks = (log->flags & RTC_LOG_TICKS) ? (blk[5] | (blk[6] << 8)) : 0;
+        return;
+    }
+    p = blk + RTC_LOG_HDR(log) + (i - 1) * RTC_LOG_WIDTH(log);
+    d = (log->flags & RTC_LOG_DELTA16) ? (p[0] | (p[1] << 8)) : p[0];
+    if (log->flags & RTC_LOG_TICKS) {
+        t = (unsigned long)*ticks + d;
+        if (t >= log->tps) {
+            if (t < 2UL * log->tps) {
+                t -= log->tps;   // The usual case - into the next second - needs no divide
+                *epoch += 1;
+            } else {
+                *epoch += t / log->tps;
+                t %= log->tps;
+            }
+        }
+        *ticks = (unsigned int)t;
+    } else {
+        *epoch += d;
+    }
+}
+
+/// The difference from one stamp to the next in the log's units, or -1 if it doesn't fit
+static long rtc_log_delta(const struct rtcLog *log, unsigned long prev, unsigned int prev_ticks,
+                          unsigned long epoch, unsigned int ticks)
+{
+    unsigned long d, limit = (log->flags & RTC_LOG_DELTA16) ? 0xFFFF : 0xFF;
+
+    if (epoch < prev || epoch - prev > limit) {
+        return -1;
+    }
+    d = epoch - prev;
+    if (log->flags & RTC_LOG_TICKS) {
+        d = rtc_mul16((unsigned int)d, log->tps) + ticks;
+        if (d < prev_ticks) {
+            return -1;
+        }
+        d -= prev_ticks;
+    }
+    return (d <= limit) ? (long)d : -1;
+}
+
+int rtc_log_init(struct rtcLog *log, void *buf, unsigned int size, unsigned int rec_size,
+                 unsigned int per_block, unsigned int flags)
+{
+    unsigned long block_size;
+    unsigned int tps = 0, prot;
+
+    if (flags & RTC_LOG_TICKS) {
+        tps = rtc_ticks_per_second();
+        if (tps == 0) {
+            return -1;   // The RTC isn't running
+        }
+    }
+    block_size = ((flags & RTC_LOG_TICKS) ? 7 : 5) +
+                 (unsigned long)(per_block - 1) * ((flags & RTC_LOG_DELTA16) ? 2 : 1) +
+                 (unsigned long)per_block * rec_size;
+    if (rec_size > 255 || per_block == 0 || per_block > 255 || block_size * 2 > size) {
+        return -1;
+    }
+
+    prot = rtc_log_unprotect();
+    log->buf = (unsigned char *)buf;
+    log->block_size = (unsigned int)block_size;
+    log->nblocks = size / (unsigned int)block_size;
+    log->tps = tps;
+    log->first = 0;
+    log->last = 0;
+    log->last_epoch = 0;
+    log->last_ticks = 0;
+    log->rec_size = (unsigned char)rec_size;
+    log->per_block = (unsigned char)per_block;
+    log->flags = (unsigned char)flags;
+    log->last_count = 0;
+    log->buf[0] = 0;
+    rtc_log_protect(prot);
+    return 0;
+}
+
+void rtc_log_write(struct rtcLog *log, const unsigned long *epochs, const unsigned int *ticks,
+                   const void *data, unsigned int n)
+{
+    const unsigned char *src = (const unsigned char *)data;
+    unsigned long prev = 0, epoch;
+    unsigned int prev_ticks = 0, t, i, cnt, prot;
+    unsigned char *blk, *p;
+    long d = -1;
+
+    if (n == 0) {
+        return;
+    }
+    // Carry on from the stamp of the newest record - kept in the log, unless a reset cut the
+    // last write short
+    blk = rtc_log_block(log, log->last);
+    if (log->last_count == blk[0]) {
+        prev = log->last_epoch;
+        prev_ticks = log->last_ticks;
+    } else {
+        for (i = 0; i < blk[0]; i++) {
+            rtc_log_decode(log, blk, i, &prev, &prev_ticks);
+        }
+    }
+
+    prot = rtc_log_unprotect();
+    log->last_count = 0;   // Stale until the batch is all in
+    for (i = 0; i < n; i++) {
+        epoch = epochs[i];
+        t = (ticks != NULL && (log->flags & RTC_LOG_TICKS)) ? ticks[i] : 0;
+        cnt = blk[0];
+        if (cnt != 0 && cnt < log->per_block) {
+            d = rtc_log_delta(log, prev, prev_ticks, epoch, t);
+        }
+        if (cnt != 0 && cnt < log->per_block && d >= 0) {
+            p = blk + RTC_LOG_HDR(log) + (cnt - 1) * RTC_LOG_WIDTH(log);
+            p[0] = (unsigned char)d;
+            if (log->flags & RTC_LOG_DELTA16) {
+                p[1] = (unsigned char)(d >> 8);
+            }
+        } else {
+            if (cnt != 0) {
+                // Start the next block, dropping the oldest if that's the one
+                cnt = rtc_log_next(log, log->last);
+                if (cnt == log->first) {
+                    log->first = rtc_log_next(log, cnt);
+                }
+                blk = rtc_log_block(log, cnt);
+                blk[0] = 0;
+                log->last = cnt;
+                cnt = 0;
+            }
+            blk[1] = (unsigned char)epoch;
+            blk[2] = (unsigned char)(epoch >> 8);
+            blk[3] = (unsigned char)(epoch >> 16);
+            blk[4] = (unsigned char)(epoch >> 24);
+            if (log->flags & RTC_LOG_TICKS) {
+                blk[5] = (unsigned char)t;
+                blk[6] = (unsigned char)(t >> 8);
+            }
+        }
+        if (log->rec_size != 0) {
+            p = blk + RTC_LOG_HDR(log) + (log->per_block - 1) * RTC_LOG_WIDTH(log) + cnt * log->rec_size;
+            memcpy(p, src, log->rec_size);
+            src += log->rec_size;
+        }
+        blk[0] = (unsigned char)(cnt + 1);   // The record only counts once it is all there
+        prev = epoch;
+        prev_ticks = t;
+    }
+    log->last_epoch = prev;
+    log->last_ticks = prev_ticks;
+    log->last_count = blk[0];
+    rtc_log_protect(prot);
+}
+
+void rtc_log_stamp(struct rtcLog *log, const void *data)
+{
+    unsigned long epoch;
+    unsigned int ticks;
+
+    epoch = rtc_now_ticks(&ticks);
+    rtc_log_write(log, &epoch, &ticks, data, 1);
+}
+
+void rtc_log_rewind(const struct rtcLog *log, struct rtcLogCursor *cur)
+{
+    cur->block = log->first;
+    cur->index = 0;
+    cur->epoch = 0;
+    cur->ticks = 0;
+}
+
+unsigned int rtc_log_read(const struct rtcLog *log, struct rtcLogCursor *cur, unsigned long *epochs,
+                          unsigned int *ticks, void *data, unsigned int n)
+{
+    unsigned char *dst = (unsigned char *)data;
+    const unsigned char *blk;
+    unsigned int got = 0;
+
+    while (got < n) {
+        blk = rtc_log_block(log, cur->block);
+        if (cur->index >= blk[0]) {
+            if (cur->block == log->last) {
+                break;   // Up to date - the next call continues from here
+            }
+            cur->block = rtc_log_next(log, cur->block);
+            cur->index = 0;
+            continue;
+        }
+        rtc_log_decode(log, blk, cur->index, &cur->epoch, &cur->ticks);
+        epochs[got] = cur->epoch;
+        if (ticks != NULL) {
+            ticks[got] = cur->ticks;
+        }
+        if (dst != NULL && log->rec_size != 0) {
+            memcpy(dst, blk + RTC_LOG_HDR(log) + (log->per_block - 1) * RTC_LOG_WIDTH(log) +
+                        cur->index * log->rec_size, log->rec_size);
+            dst += log->rec_size;
+        }
+        cur->index++;
+        got++;
+    }
+    return got;
+}
@@ -0,0 +1,61 @@
+/**
+  * MSP430 Real Time Clock Kit
+  *
+  * Month and day-of-week name tables.  Kept apart from rtckit.c so a build that never
+  * prints names can leave this file out and save the ~280 bytes of FRAM they occupy.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include "rtckit.h"
+
+const struct rtcMonthInfo monthInfo[12] =
+{
+    {31, "Jan", "January"},
+    {28, "Feb", "February"},
+    {31, "Mar", "March"},
+    {30, "Apr", "April"},
+    {31, "May", "May"},
+    {30, "Jun", "June"},
+    {31, "Jul", "July"},
+    {31, "Aug", "August"},
+    {30, "Sep", "September"},
+    {31, "Oct", "October"},
+    {30, "Nov", "November"},
+    {31, "Dec", "December"}
+};
+
+const struct rtcDayInfo dayInfo[7] =
+{
+    {"Sun", "Sunday"},
+    {"Mon", "Monday"},
+    {"Tue", "Tuesday"},
+    {"Wed", "Wednesday"},
+    {"Thu", "Thursday"},
+    {"Fri", "Friday"},
+    {"Sat", "Saturday"}
+};
@@ -0,0 +1,363 @@
+/**
+  * MSP430 Real Time Clock Kit
+  *
+  * Time string parsers: ISO 8601, HTTP-date and a character-at-a-time NMEA RMC parser.
+  * Each goes straight from the text to an epoch in one pass, using the same closed-form
+  * days-from-civil arithmetic as the conversions - no struct tm, no rtc_epoch().
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include "rtckit.h"
+#include "rtckit_arith.h"
+
+/// Three-letter names as HTTP-date spells them, independent of rtckit_names.c
+static const char rtc_parse_months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+static const char rtc_parse_days[] = "SunMonTueWedThuFriSat";
+
+/// Day number and second of the day of the last epoch an unsigned long holds, Feb 7 2106 06:28:15
+#define RTC_PARSE_LAST_DAY 49710
+#define RTC_PARSE_LAST_SOD 23295L
+
+/** Validate a date & time and turn it into an epoch
+ *
+ * @param[in] Full year, calendar month 1-12, day of the month, hour, minute, second (60 is
+ *            accepted for a leap second and lands on the next second)
+ * @param[in] UTC offset the time is given in, seconds east
+ * @param[in] Pointer receiving the epoch
+ * @param[out] 0 on success, -1 if out of range or the UTC time doesn't fit an epoch
+ */
+static int rtc_parse_make_epoch(unsigned int year, unsigned int mon, unsigned int mday,
+                                unsigned int hour, unsigned int min, unsigned int sec,
+                                long offset, unsigned long *epoch)
+{
+    unsigned int leap;
+    long day, sod;
+
+    if (year < 1970 || year > 2106 || mon < 1 || mon > 12 || mday < 1 ||
+        hour > 23 || min > 59 || sec > 60) {
+        return -1;
+    }
+    leap = (year & 3) == 0 && year != 2100;
+    if (mday > rtc_yday_before_month[leap][mon] - rtc_yday_before_month[leap][mon-1]) {
+        return -1;
+    }
+
+    // The offset is under a day, so it moves the date by one day at most either way
+    day = (long)rtc_days_from_civil(year, mon - 1, mday);
+    sod = (long)rtc_mul16(hour, 3600) + min * 60 + sec - offset;
+    if (sod < 0) {
+        sod += 86400;
+        day--;
+    } else if (sod >= 86400) {
+        sod -= 86400;
+        day++;
+    }
+    if (day < 0 || day > RTC_PARSE_LAST_DAY || (day == RTC_PARSE_LAST_DAY && sod > RTC_PARSE_LAST_SOD)) {
+        return -1;
+    }
+    *epoch = (rtc_mul16((unsigned int)day, 675) << 7) + (unsigned long)sod;
+    return 0;
+}
+
+/// Parse exactly n digits (n <= 4), -1 if any is missing
+static int rtc_parse_digits(const char *s, unsigned int n)
+{
+    int value = 0;
+
+    while (n--) {
+        if (*s < '0' || *s > '9') {
+            return -1;
+        }
+        value = value * 10 + (*s++ - '0');
+    }
+    return value;
+}
+
+/// Find a three-letter name in a table of them, -1 if it isn't there
+static int rtc_parse_name3(const char *s, const char *table, unsigned int count)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++, table += 3) {
+        // Short-circuits at the first mismatch, so never reads past a terminator
+        if (s[0] == table[0] && s[1] == table[1] && s[2] == table[2]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int rtc_parse_iso8601(const char *s, unsigned long *epoch)
+{
+    int year, mon, mday, hour = 0, min = 0, sec = 0, zh, zm = 0;
+    long offset = 0;
+    char sign;
+
+    // Each check comes before the character after it is looked at, so a short string is safe
+    if ((year = rtc_parse_digits(s, 4)) < 0 || s[4] != '-' ||
+        (mon = rtc_parse_digits(s + 5, 2)) < 0 || s[7] != '-' ||
+        (mday = rtc_parse_digits(s + 8, 2)) < 0) {
+        return -1;
+    }
+    s += 10;
+
+    if (*s == 'T' || *s == ' ') {
+        if ((hour = rtc_parse_digits(s + 1, 2)) < 0 || s[3] != ':' ||
+            (min = rtc_parse_digits(s + 4, 2)) < 0) {
+            return -1;
+        }
+        s += 6;
+        if (*s == ':') {
+            if ((sec = rtc_parse_digits(s + 1, 2)) < 0) {
+                return -1;
+            }
+            s += 3;
+            if (*s == '.' || *s == ',') {
+                // Fraction of a second - truncated, but it needs at least one digit
+                if (s[1] < '0' || s[1] > '9') {
+                    return -1;
+                }
+                do {
+                    s++;
+                } while (*s >= '0' && *s <= '9');
+            }
+        }
+
+        if (*s == 'Z') {
+            s++;
+        } else if (*s == '+' || *s == '-') {
+            // +hh, +hhmm or +hh:mm
+            sign = *s;
+            if ((zh = rtc_parse_digits(s + 1, 2)) < 0 || zh > 23) {
+                return -1;
+            }
+            s += 3;
+            if (*s != '\0') {
+                if (*s == ':') {
+                    s++;  // Past the colon the minutes have to follow - "+02:" is no offset
+                }
+                if ((zm = rtc_parse_digits(s, 2)) < 0 || zm > 59) {
+                    return -1;
+                }
+                s += 2;
+            }
+            offset = rtc_mul16(zh, 3600) + zm * 60;
+            if (sign == '-') {
+                offset = -offset;
+            }
+        }
+    }
+    if (*s != '\0') {
+        return -1;
+    }
+
+    // The time was local to the given offset; it is shifted to UTC on the way
+    return rtc_parse_make_epoch(year, mon, mday, hour, min, sec, offset, epoch);
+}
+
+int rtc_parse_http_date(const char *s, unsigned long *epoch)
+{
+    int wday, mday, mon, year, hour, min, sec;
+    unsigned long t;
+
+    // "Sun, 06 Nov 1994 08:49:37 GMT" - the IMF-fixdate form RFC 9110 requires of senders
+    if ((wday = rtc_parse_name3(s, rtc_parse_days, 7)) < 0 || s[3] != ',' || s[4] != ' ' ||
+        (mday = rtc_parse_digits(s + 5, 2)) < 0 || s[7] != ' ' ||
+        (mon = rtc_parse_name3(s + 8, rtc_parse_months, 12)) < 0 || s[11] != ' ' ||
+        (year = rtc_parse_digits(s + 12, 4)) < 0 || s[16] != ' ' ||
+        (hour = rtc_parse_digits(s + 17, 2)) < 0 || s[19] != ':' ||
+        (min = rtc_parse_digits(s + 20, 2)) < 0 || s[22] != ':' ||
+        (sec = rtc_parse_digits(s + 23, 2)) < 0 || s[25] != ' ' ||
+        s[26] != 'G' || s[27] != 'M' || s[28] != 'T' || s[29] != '\0') {
+        return -1;
+    }
+
+    if (rtc_parse_make_epoch(year, mon + 1, mday, hour, min, sec, 0, &t) != 0) {
+        return -1;
+    }
+    // The weekday is redundant - a mismatch means a garbled date.  Jan 1 1970 was a Thursday.
+    if (rtc_mod7((unsigned int)rtc_days_from_civil(year, mon, mday) + 4) != (unsigned int)wday) {
+        return -1;
+    }
+    *epoch = t;
+    return 0;
+}
+
+// NMEA RMC parser
+
+/// rtcNmeaParser.state
+#define RTC_NMEA_IDLE     0
+#define RTC_NMEA_BODY     1
+#define RTC_NMEA_CHECKSUM 2
+
+/// rtcNmeaParser.flags
+#define RTC_NMEA_HAVE_TIME 0x01
+#define RTC_NMEA_HAVE_DATE 0x02
+#define RTC_NMEA_VALID     0x04
+
+/// RMC field numbers, counting the sentence ID as field 0
+#define RTC_NMEA_FIELD_TIME   1
+#define RTC_NMEA_FIELD_STATUS 2
+#define RTC_NMEA_FIELD_DATE   9
+
+void rtc_nmea_init(struct rtcNmeaParser *p)
+{
+    p->state = RTC_NMEA_IDLE;
+}
+
+/// Value of a hex digit, or 0xFF
+static unsigned char rtc_nmea_hex(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return 0xFF;
+}
+
+int rtc_nmea_feed(struct rtcNmeaParser *p, char c, unsigned long *epoch)
+{
+    unsigned char nibble;
+    unsigned int year;
+
+    if (c == '$') {
+        // Start of a sentence - also resynchronizes after a garbled one
+        p->state = RTC_NMEA_BODY;
+        p->field = 0;
+        p->pos = 0;
+        p->sum = 0;
+        p->flags = 0;
+        return 0;
+    }
+
+    switch (p->state) {
+        case RTC_NMEA_BODY:
+            if (c == '*') {
+                p->state = RTC_NMEA_CHECKSUM;
+                p->pos = 0;
+                p->rxsum = 0;
+                return 0;
+            }
+            if (c < ' ' || c > '~') {
+                break;  // Line ended without a checksum
+            }
+            p->sum ^= c;
+            if (c == ',') {
+                if (p->field == 0 && p->pos != 5) {
+                    break;
+                }
+                if (p->field == RTC_NMEA_FIELD_TIME && (p->pos == 6 || p->pos > 7)) {
+                    p->flags |= RTC_NMEA_HAVE_TIME;
+                } else if (p->field == RTC_NMEA_FIELD_DATE && p->pos == 6) {
+                    p->flags |= RTC_NMEA_HAVE_DATE;
+                }
+                p->field++;
+                p->pos = 0;
+                return 0;
+            }
+
+            switch (p->field) {
+                case 0:
+                    // Any talker ("GP", "GN", ...) followed by RMC
+                    if (p->pos >= 2 && (p->pos > 4 || c != "RMC"[p->pos - 2])) {
+                        break;
+                    }
+                    p->pos++;
+                    return 0;
+                case RTC_NMEA_FIELD_TIME:
+                    // hhmmss, then an optional fraction that is ignored - but checked all the same
+                    if (p->pos == 6) {
+                        if (c != '.') {
+                            break;
+                        }
+                    } else if (c < '0' || c > '9') {
+                        break;
+                    } else if (p->pos < 6) {
+                        p->digits[p->pos] = c - '0';
+                    }
+                    if (p->pos < 0xFF) {
+                        p->pos++;
+                    }
+                    return 0;
+                case RTC_NMEA_FIELD_STATUS:
+                    // Exactly "A" - anything after it, or before it, leaves the fix invalid
+                    if (p->pos == 0 && c == 'A') {
+                        p->flags |= RTC_NMEA_VALID;
+                    } else {
+                        p->flags &= ~RTC_NMEA_VALID;
+                    }
+                    if (p->pos < 0xFF) {
+                        p->pos++;
+                    }
+                    return 0;
+                case RTC_NMEA_FIELD_DATE:
+                    // ddmmyy
+                    if (p->pos >= 6 || c < '0' || c > '9') {
+                        break;
+                    }
+                    p->digits[6 + p->pos++] = c - '0';
+                    return 0;
+                default:
+                    return 0;
+            }
+            break;
+
+        case RTC_NMEA_CHECKSUM:
+            nibble = rtc_nmea_hex(c);
+            if (nibble == 0xFF) {
+                break;
+            }
+            p->rxsum = (p->rxsum << 4) | nibble;
+            if (++p->pos < 2) {
+                return 0;
+            }
+            p->state = RTC_NMEA_IDLE;
+            if (p->rxsum != p->sum ||
+                p->flags != (RTC_NMEA_HAVE_TIME | RTC_NMEA_HAVE_DATE | RTC_NMEA_VALID)) {
+                return 0;
+            }
+            // Two-digit year: 80-99 are 1980-1999 as NMEA 0183 reads them, the rest 20xx
+            year = p->digits[10] * 10 + p->digits[11];
+            year += (year >= 80) ? 1900 : 2000;
+            return rtc_parse_make_epoch(year,
+                                        p->digits[8] * 10 + p->digits[9],
+                                        p->digits[6] * 10 + p->digits[7],
+                                        p->digits[0] * 10 + p->digits[1],
+                                        p->digits[2] * 10 + p->digits[3],
+                                        p->digits[4] * 10 + p->digits[5], 0, epoch) == 0;
+
+        default:
+            return 0;
+    }
+
+    // Not the sentence we want, or garbled - skip to the next '$'
+    p->state = RTC_NMEA_IDLE;
+    return 0;
+}
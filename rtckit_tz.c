@@ -0,0 +1,379 @@
+/**
+  * MSP430 Real Time Clock Kit
+  *
+  * Local time: POSIX-TZ style timezone rules with a cached UTC offset.  The offset in effect
+  * is kept together with the window of epochs it holds for - the span between the DST
+  * transitions either side - so converting to local time only recomputes the rule when a
+  * transition has been crossed.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include "rtckit.h"
+#include "rtckit_arith.h"
+
+/// The active timezone, UTC until rtc_tz_set() is called
+static struct rtcTimezone rtc_tz;
+
+/// Offset and DST flag in effect for the epochs in [from, until)
+struct rtcTzWindow
+{
+    unsigned long from;
+    unsigned long until;  // from == until marks the cache as empty
+    long offset;
+    unsigned int isdst;
+};
+
+/** The last window looked up.  An RTC_HANDLER_IN_ISR handler may convert to local time as
+ *  well, so it is only ever written with interrupts masked, each write bumping rtc_tz_gen -
+ *  a reader that sees rtc_tz_gen move under it reads again, as with rtc_interpret_dt().
+ */
+static volatile struct rtcTzWindow rtc_tz_cache;
+static volatile unsigned int rtc_tz_gen;
+
+/// Stands in for a transition past the last epoch an unsigned long holds - it never comes
+#define RTC_TZ_NEVER 0xFFFFFFFFUL
+
+/** Epoch at which a transition rule fires in the given year
+ *
+ * @param[in] The rule
+ * @param[in] Full year
+ * @param[in] UTC offset in effect before the transition, seconds east
+ * @param[out] The epoch, or RTC_TZ_NEVER if it falls past Feb 7 2106 06:28:15
+ */
+static unsigned long rtc_tz_transition(const struct rtcTzRule *rule, unsigned int year, long offset)
+{
+    unsigned int leap = (year & 3) == 0 && year != 2100;
+    unsigned int mon = rule->mon - 1;
+    unsigned long days = rtc_days_from_civil(year, mon, 1);
+    unsigned int mlen = rtc_yday_before_month[leap][mon+1] - rtc_yday_before_month[leap][mon];
+    unsigned int wday1 = rtc_mod7((unsigned int)days + 4);  // Jan 1 1970 was a Thursday
+    unsigned int mday;
+    long at;
+
+    // First matching weekday of the month, then on by whole weeks - week 5 means the last one
+    mday = rule->wday + 7 - wday1;
+    if (mday >= 7) {
+        mday -= 7;
+    }
+    mday += 7 * (rule->week - 1);
+    while (mday >= mlen) {
+        mday -= 7;
+    }
+
+    // Day 49710 is Feb 7 2106, the last whose midnight fits; the time of day can still carry past
+    days += mday;
+    if (days > 49710UL) {
+        return RTC_TZ_NEVER;
+    }
+    at = rule->time - offset;
+    if (at > 0 && days * 86400UL > RTC_TZ_NEVER - (unsigned long)at) {
+        return RTC_TZ_NEVER;
+    }
+    return days * 86400UL + at;
+}
+
+/** Work out the window containing epoch
+ *  The window runs between the transitions either side of epoch; with no DST it covers all time.
+ *  Transitions past Feb 7 2106 06:28:15 never come, so the last window runs to 0xFFFFFFFF.
+ */
+static void rtc_tz_window(unsigned long epoch, struct rtcTzWindow *w)
+{
+    struct rtc_datetime dt;
+    unsigned long start, end, prev, next;
+    unsigned int year, isdst;
+
+    if (rtc_tz.dst_offset == rtc_tz.std_offset) {
+        w->offset = rtc_tz.std_offset;
+        w->isdst = 0;
+        w->from = 0;
+        w->until = 0xFFFFFFFFUL;
+        return;
+    }
+
+    // A window ends short of its until, so the last second there is goes with the one before it
+    if (epoch == RTC_TZ_NEVER) {
+        epoch--;
+    }
+    if (rtc_tz.std_offset < 0 && epoch < (unsigned long)-rtc_tz.std_offset) {
+        year = 1970;  // Local time would still be in 1969
+    } else if (rtc_tz.std_offset > 0 && epoch > RTC_TZ_NEVER - rtc_tz.std_offset) {
+        year = 2106;  // Local time would be past the last epoch
+    } else {
+        rtc_interpret_dt(epoch + rtc_tz.std_offset, &dt);
+        year = dt.year;
+    }
+    start = rtc_tz_transition(&rtc_tz.dst_start, year, rtc_tz.std_offset);
+    end = rtc_tz_transition(&rtc_tz.dst_end, year, rtc_tz.dst_offset);
+
+    if (start == RTC_TZ_NEVER && end == RTC_TZ_NEVER) {
+        // Early 2106, with neither of the year's transitions in reach - whatever the last one of
+        // 2105 set holds to the end
+        start = rtc_tz_transition(&rtc_tz.dst_start, year - 1, rtc_tz.std_offset);
+        end = rtc_tz_transition(&rtc_tz.dst_end, year - 1, rtc_tz.dst_offset);
+        isdst = start > end;
+        prev = isdst ? start : end;
+        next = RTC_TZ_NEVER;
+    } else if (start < end) {
+        // Northern hemisphere - DST in the middle of the year
+        if (epoch < start) {
+            isdst = 0;
+            prev = (year > 1970) ? rtc_tz_transition(&rtc_tz.dst_end, year - 1, rtc_tz.dst_offset) : 0;
+            next = start;
+        } else if (epoch < end) {
+            isdst = 1;
+            prev = start;
+            next = end;
+        } else {
+            isdst = 0;
+            prev = end;
+            next = (year < 2106) ? rtc_tz_transition(&rtc_tz.dst_start, year + 1, rtc_tz.std_offset) : RTC_TZ_NEVER;
+        }
+    } else {
+        // Southern hemisphere - DST across the turn of the year
+        if (epoch < end) {
+            isdst = 1;
+            prev = (year > 1970) ? rtc_tz_transition(&rtc_tz.dst_start, year - 1, rtc_tz.std_offset) : 0;
+            next = end;
+        } else if (epoch < start) {
+            isdst = 0;
+            prev = end;
+            next = start;
+        } else {
+            isdst = 1;
+            prev = start;
+            next = (year < 2106) ? rtc_tz_transition(&rtc_tz.dst_end, year + 1, rtc_tz.dst_offset) : RTC_TZ_NEVER;
+        }
+    }
+
+    w->offset = isdst ? rtc_tz.dst_offset : rtc_tz.std_offset;
+    w->isdst = isdst;
+    w->from = prev;
+    w->until = next;
+}
+
+/// The window containing epoch - from the cache, or worked out and cached
+static void rtc_tz_lookup(unsigned long epoch, struct rtcTzWindow *w)
+{
+    unsigned int gen = rtc_tz_gen;
+
+    w->from = rtc_tz_cache.from;
+    w->until = rtc_tz_cache.until;
+    w->offset = rtc_tz_cache.offset;
+    w->isdst = rtc_tz_cache.isdst;
+    // One compare covers both ends of the window: below from the subtraction wraps and comes out large
+    if (rtc_tz_gen == gen && epoch - w->from < w->until - w->from) {
+        return;
+    }
+
+    rtc_tz_window(epoch, w);
+
+    RTCKIT_CRITICAL_ENTER();
+    if (rtc_tz_gen == gen) {
+        // Nothing has been stored since the lookup began - an rtc_tz_set() in between would
+        // leave this window out of date
+        rtc_tz_cache.from = w->from;
+        rtc_tz_cache.until = w->until;
+        rtc_tz_cache.offset = w->offset;
+        rtc_tz_cache.isdst = w->isdst;
+        rtc_tz_gen++;
+    }
+    RTCKIT_CRITICAL_EXIT();
+}
+
+void rtc_tz_set(const struct rtcTimezone *tz)
+{
+    RTCKIT_CRITICAL_ENTER();
+    rtc_tz = *tz;
+    rtc_tz_cache.from = 0;
+    rtc_tz_cache.until = 0;
+    rtc_tz_gen++;
+    RTCKIT_CRITICAL_EXIT();
+}
+
+long rtc_tz_offset(unsigned long epoch, unsigned int *isdst)
+{
+    struct rtcTzWindow w;
+
+    rtc_tz_lookup(epoch, &w);
+    if (isdst != NULL) {
+        *isdst = w.isdst;
+    }
+    return w.offset;
+}
+
+unsigned long rtc_tz_next_transition(unsigned long epoch)
+{
+    struct rtcTzWindow w;
+
+    rtc_tz_lookup(epoch, &w);
+    return (w.until == 0xFFFFFFFFUL) ? 0 : w.until;
+}
+
+struct tm * rtc_interpret_local_r(unsigned long epoch, struct tm *timebuf)
+{
+    unsigned int isdst;
+    long offset = rtc_tz_offset(epoch, &isdst);
+
+    rtc_interpret_r(epoch + offset, timebuf);
+    timebuf->tm_isdst = isdst;
+    return timebuf;
+}
+
+/// This buffer is offered out to user functions as return value of rtc_interpret_local()
+static struct tm localbuf;
+
+struct tm * rtc_interpret_local(unsigned long epoch)
+{
+    return rtc_interpret_local_r(epoch, &localbuf);
+}
+
+// POSIX TZ string parsing
+
+/// Parse an unsigned decimal number, up to max
+static const char * rtc_tz_parse_num(const char *s, unsigned int max, unsigned int *value)
+{
+    unsigned int n = 0;
+
+    if (*s < '0' || *s > '9') {
+        return NULL;
+    }
+    while (*s >= '0' && *s <= '9') {
+        n = n * 10 + (*s++ - '0');
+        if (n > max) {
+            return NULL;
+        }
+    }
+    *value = n;
+    return s;
+}
+
+/// Parse [+-]hh[:mm[:ss]] into seconds
+static const char * rtc_tz_parse_time(const char *s, long *secs)
+{
+    unsigned int h, m = 0, sec = 0;
+    int negative = 0;
+
+    if (*s == '+' || *s == '-') {
+        negative = (*s++ == '-');
+    }
+    s = rtc_tz_parse_num(s, 167, &h);
+    if (s != NULL && *s == ':') {
+        s = rtc_tz_parse_num(s + 1, 59, &m);
+        if (s != NULL && *s == ':') {
+            s = rtc_tz_parse_num(s + 1, 59, &sec);
+        }
+    }
+    if (s != NULL) {
+        *secs = h * 3600L + m * 60 + sec;
+        if (negative) {
+            *secs = -*secs;
+        }
+    }
+    return s;
+}
+
+/// Skip a zone name - three or more letters, or anything between < and >
+static const char * rtc_tz_parse_name(const char *s)
+{
+    const char *name = s;
+
+    if (*s == '<') {
+        while (*++s != '>') {
+            if (*s == '\0') {
+                return NULL;
+            }
+        }
+        return s + 1;
+    }
+    while ((*s >= 'A' && *s <= 'Z') || (*s >= 'a' && *s <= 'z')) {
+        s++;
+    }
+    return (s - name >= 3) ? s : NULL;
+}
+
+/// Parse ,Mm.w.d[/time]
+static const char * rtc_tz_parse_rule(const char *s, struct rtcTzRule *rule)
+{
+    unsigned int mon, week, wday;
+
+    if (*s++ != ',' || *s++ != 'M') {
+        return NULL;
+    }
+    s = rtc_tz_parse_num(s, 12, &mon);
+    if (s == NULL || mon == 0 || *s++ != '.') {
+        return NULL;
+    }
+    s = rtc_tz_parse_num(s, 5, &week);
+    if (s == NULL || week == 0 || *s++ != '.') {
+        return NULL;
+    }
+    s = rtc_tz_parse_num(s, 6, &wday);
+    if (s == NULL) {
+        return NULL;
+    }
+    rule->mon = mon;
+    rule->week = week;
+    rule->wday = wday;
+    rule->time = 7200;  // POSIX default, 02:00 local
+    if (*s == '/') {
+        s = rtc_tz_parse_time(s + 1, &rule->time);
+    }
+    return s;
+}
+
+int rtc_tz_parse(const char *posix, struct rtcTimezone *tz)
+{
+    const char *s = rtc_tz_parse_name(posix);
+    long offset;
+
+    // POSIX offsets count hours west of Greenwich; struct rtcTimezone has them east
+    if (s == NULL || (s = rtc_tz_parse_time(s, &offset)) == NULL) {
+        return -1;
+    }
+    tz->std_offset = -offset;
+    tz->dst_offset = -offset;
+    if (*s == '\0') {
+        return 0;
+    }
+
+    if ((s = rtc_tz_parse_name(s)) == NULL) {
+        return -1;
+    }
+    tz->dst_offset = tz->std_offset + 3600;
+    if (*s != ',') {
+        if ((s = rtc_tz_parse_time(s, &offset)) == NULL) {
+            return -1;
+        }
+        tz->dst_offset = -offset;
+    }
+    if ((s = rtc_tz_parse_rule(s, &tz->dst_start)) == NULL ||
+        (s = rtc_tz_parse_rule(s, &tz->dst_end)) == NULL || *s != '\0') {
+        return -1;
+    }
+    return 0;
+}
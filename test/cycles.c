@@ -0,0 +1,286 @@
+/**
+  * MSP430 Real Time Clock Kit - cycles-per-call harness for the conversion code
+  *
+  * Each conversion is run RUNS times over a spread of epochs and the cost per call printed.
+  * On an MSP430 the count is in MCLK cycles, captured by software on Timer0_A3 CCR1 with the
+  * timer running continuously from SMCLK - so SMCLK must equal MCLK (DIVS = 0) - with the cost
+  * of an empty call taken off.  The closed-form conversion behind rtc_interpret() is also timed
+  * one epoch at a time and the difference between its slowest and fastest epoch reported: being
+  * constant-time, it should stay at a few cycles whatever the date.
+  * Nothing is printed there: the results are left in cycles_report[] for the debugger to read,
+  * and a result over its cycles_baseline[] entry sets cycles_failed.  On a host the cost is in
+  * nanoseconds, which says nothing about the target but keeps the harness itself building.
+  *
+  *   make -C test cycles                               (host)
+  *   make -C test cycles CC=msp430-elf-gcc MCU=msp430fr2433
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include "rtckit.h"
+#include "rtckit_arith.h"
+
+#if defined(__MSP430__)
+#include <msp430.h>
+#define CYCLES_UNIT "cycles"
+#define CYCLES_REPEAT 1
+typedef unsigned int cycles_t;
+#else
+#include <stdio.h>
+#include <time.h>
+#define CYCLES_UNIT "ns"
+#define CYCLES_REPEAT 100000UL       /* A host timer is too coarse for a single pass */
+typedef unsigned long long cycles_t;
+#endif
+
+/// Calls timed per result; the epochs come from a table, so each call converts a different one
+#define RUNS 16
+
+/// One line of the report
+struct cyclesResult
+{
+    const char *name;
+    unsigned long per_call;
+};
+
+enum
+{
+    CYCLES_INTERPRET_SAME_DAY,
+    CYCLES_INTERPRET_NEW_DAY,
+    CYCLES_EPOCH,
+    CYCLES_NORMALIZE,
+    CYCLES_FORMAT_ISO8601,
+    CYCLES_PARSE_ISO8601,
+    CYCLES_DIV86400,
+    CYCLES_MUL16,
+    CYCLES_INTERPRET_SPREAD,
+    CYCLES_COUNT
+};
+
+struct cyclesResult cycles_report[CYCLES_COUNT];
+
+/** Worst cost per call on the target, in MCLK cycles - 0 leaves a result unchecked
+ *  Record these from a run on the part in use, then rebuild to have regressions flagged.
+ */
+const unsigned long cycles_baseline[CYCLES_COUNT] = {0};
+
+volatile unsigned int cycles_failed;
+
+/// Somewhere for the results to go, so the calls aren't optimized away
+volatile unsigned long cycles_sink;
+
+static unsigned long epochs[RUNS];
+
+static cycles_t cycles_now(void)
+{
+#if defined(__MSP430__)
+    TA0CCTL1 ^= CCIS0;  // GND to VCC or back - an edge, captured on the next timer clock
+    return TA0CCR1;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (cycles_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static void cycles_start_clock(void)
+{
+#if defined(__MSP430__)
+    WDTCTL = WDTPW | WDTHOLD;
+    TA0CTL = TASSEL__SMCLK | MC__CONTINUOUS | TACLR;
+    TA0CCTL1 = CM_3 | CCIS_2 | SCS | CAP;
+#endif
+}
+
+/// Cost of one call of fn(i), less the cost of the loop around it - RUNS calls must take under 65536 cycles
+static unsigned long cycles_time(void (*fn)(unsigned int))
+{
+    static cycles_t overhead;
+    static unsigned int have_overhead;
+    cycles_t start, spent;
+    unsigned long n;
+    unsigned int i;
+
+    start = cycles_now();
+    for (n = 0; n < CYCLES_REPEAT; n++) {
+        for (i = 0; i < RUNS; i++) {
+            fn(i);
+        }
+    }
+    spent = cycles_now() - start;
+    if (!have_overhead) {
+        have_overhead = 1;
+        overhead = spent;
+        return 0;
+    }
+    return (unsigned long)((spent > overhead ? spent - overhead : 0) / (RUNS * CYCLES_REPEAT));
+}
+
+/// Cost of fn(i) for one i at a time: the slowest less the fastest over all RUNS of them
+static unsigned long cycles_spread(void (*fn)(unsigned int))
+{
+    cycles_t start, spent, least = 0, most = 0;
+    unsigned long n;
+    unsigned int i;
+
+    for (i = 0; i < RUNS; i++) {
+        fn(i);  // Once untimed, so every timed call finds the same state
+        start = cycles_now();
+        for (n = 0; n < CYCLES_REPEAT; n++) {
+            fn(i);
+        }
+        spent = cycles_now() - start;
+        if (i == 0 || spent < least) {
+            least = spent;
+        }
+        if (i == 0 || spent > most) {
+            most = spent;
+        }
+    }
+    return (unsigned long)((most - least) / CYCLES_REPEAT);
+}
+
+static void run_empty(unsigned int i)
+{
+    cycles_sink = i;
+}
+
+static void run_interpret_same_day(unsigned int i)
+{
+    cycles_sink = rtc_interpret(epochs[0] + i)->tm_sec;
+}
+
+static void run_interpret_new_day(unsigned int i)
+{
+    cycles_sink = rtc_interpret(epochs[i])->tm_mday;  // Each epoch is on another day
+}
+
+static void run_interpret_days(unsigned int i)
+{
+    struct rtc_datetime dt;
+    unsigned long sod;
+    unsigned long days = rtc_div86400(epochs[i], &sod);
+
+    rtc_interpret_days(days, sod, &dt);  // rtc_interpret() without its cache
+    cycles_sink = dt.mday;
+}
+
+static void run_epoch(unsigned int i)
+{
+    struct tm t = *rtc_interpret(epochs[i]);
+
+    t.tm_yday = 0;
+    cycles_sink = rtc_epoch(&t);
+}
+
+static void run_normalize(unsigned int i)
+{
+    struct tm t = *rtc_interpret(epochs[i]);
+
+    t.tm_min += 75;
+    t.tm_mday += 40;
+    cycles_sink = rtc_normalize(&t);
+}
+
+static void run_format_iso8601(unsigned int i)
+{
+    char buf[RTC_ISO8601_LEN + 1];
+
+    cycles_sink = rtc_format_iso8601(epochs[i], buf);
+}
+
+static const char *iso_samples[4] =
+{
+    "2026-10-14T09:30:00Z", "1999-12-31T23:59:59Z", "2038-01-19T03:14:08+01:00", "2106-02-07T06:28:15Z"
+};
+
+static void run_parse_iso8601(unsigned int i)
+{
+    unsigned long e;
+
+    cycles_sink = rtc_parse_iso8601(iso_samples[i & 3], &e) + e;
+}
+
+static void run_div86400(unsigned int i)
+{
+    unsigned long sod;
+
+    cycles_sink = rtc_div86400(epochs[i], &sod) + sod;
+}
+
+static void run_mul16(unsigned int i)
+{
+    cycles_sink = rtc_mul16((unsigned int)epochs[i], i);
+}
+
+int main(void)
+{
+    static const struct { const char *name; void (*fn)(unsigned int); } runs[CYCLES_COUNT] =
+    {
+        { "rtc_interpret, same day", run_interpret_same_day },
+        { "rtc_interpret, new day", run_interpret_new_day },
+        { "rtc_epoch (+ rtc_interpret)", run_epoch },
+        { "rtc_normalize (+ rtc_interpret)", run_normalize },
+        { "rtc_format_iso8601", run_format_iso8601 },
+        { "rtc_parse_iso8601", run_parse_iso8601 },
+        { "rtc_div86400", run_div86400 },
+        { "rtc_mul16", run_mul16 },
+        { "rtc_interpret_days, spread", run_interpret_days },
+    };
+    unsigned int i;
+
+    cycles_start_clock();
+    for (i = 0; i < RUNS; i++) {
+        // Days spread over the whole epoch range, at an hour that moves with them
+        epochs[i] = (unsigned long)i * 3105UL * 86400UL + (i * 3607UL) % 86400UL;
+    }
+
+    cycles_time(run_empty);
+    for (i = 0; i < CYCLES_COUNT; i++) {
+        cycles_report[i].name = runs[i].name;
+        if (i == CYCLES_INTERPRET_SPREAD) {
+            cycles_report[i].per_call = cycles_spread(runs[i].fn);
+        } else {
+            cycles_report[i].per_call = cycles_time(runs[i].fn);
+        }
+        if (cycles_baseline[i] != 0 && cycles_report[i].per_call > cycles_baseline[i]) {
+            cycles_failed = 1;
+        }
+#if !defined(__MSP430__)
+        printf("%-34s %6lu %s/call\n", cycles_report[i].name, cycles_report[i].per_call, CYCLES_UNIT);
+#endif
+    }
+
+#if defined(__MSP430__)
+    for (;;) {
+        __no_operation();  // Read cycles_report[] and cycles_failed from here
+    }
+#else
+    return cycles_failed;
+#endif
+}
@@ -0,0 +1,148 @@
+/**
+  * MSP430 Real Time Clock Kit - host test register stub
+  *
+  * Stands in for <msp430.h> when rtckit.c is built on a host for the tests.  The registers the
+  * default configuration touches are plain variables, defined in msp430_stub.c; the tests play
+  * the part of the hardware through rtc_stub_count(), which runs RTCCNT and calls RTC_ISR() -
+  * or the rtc_stub_isr a test puts in, straight away or once interrupts are enabled again.
+  * rtc_stub_gate() has reads of RTCCNT take time on a reference clock driving TA0R, so the
+  * VLO calibration gate can be run against a VLO of known speed.  The MPY32 result registers are computed from MPY and
+  * OP2 when read, and the intrinsics keep a status register whose GIE bit the tests can check.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#ifndef RTCKIT_TEST_MSP430_H
+#define RTCKIT_TEST_MSP430_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define __MSP430_HAS_RTC__
+#define __MSP430_HAS_CS__
+#define __MSP430_HAS_MPY32__
+#define __MSP430_HAS_T0A3__
+
+/// RTC counter
+extern volatile unsigned int RTCCTL, RTCIV, RTCMOD;
+extern volatile unsigned int rtc_stub_rtccnt;
+volatile unsigned int *rtc_stub_read_cnt(void);
+#define RTCCNT (*rtc_stub_read_cnt())
+#define RTCIF               0x0001
+#define RTCIE               0x0002
+#define RTCSR               0x0040
+#define RTCIV_RTCIF         0x0002
+#define RTC_VECTOR          5
+#define RTCSS__SMCLK        0x1000
+#define RTCSS__VLOCLK       0x2000
+#define RTCSS__XT1CLK       0x3000
+#define RTCSS_3             0x3000
+#define RTCPS__1            0x0000
+#define RTCPS__10           0x0100
+#define RTCPS__16           0x0200
+#define RTCPS__64           0x0300
+#define RTCPS__100          0x0400
+#define RTCPS__256          0x0500
+#define RTCPS__1000         0x0600
+#define RTCPS__1024         0x0700
+
+/// Clock system - the SMCLK speed guess reads these
+extern volatile unsigned int CSCTL1, CSCTL4, CSCTL5;
+#define SELMS_0             0x0000
+#define SELMS_7             0x0007
+#define DCORSEL_0           0x0000
+#define DCORSEL_1           0x0010
+#define DCORSEL_2           0x0020
+#define DCORSEL_3           0x0030
+#define DCORSEL_4           0x0040
+#define DCORSEL_5           0x0050
+#define DCORSEL_6           0x0060
+#define DCORSEL_7           0x0070
+#define DIVS_3              0x0030
+
+/// FRAM write protection and the PMM
+extern volatile unsigned int SYSCFG0, PMMIFG;
+extern volatile unsigned char PMMCTL0_H, PMMCTL0_L;
+#define PFWP                0x0001
+#define DFWP                0x0002
+#define FRWPPW              0xA500
+#define PMMPW_H             0xA5
+#define PMMREGOFF           0x10
+#define PMMLPM5IFG          0x8000
+
+/// Timer_A0 - the VLO calibration gate and the cycle harness
+extern volatile unsigned int TA0CTL, TA0R;
+#define TASSEL__ACLK        0x0100
+#define TASSEL__SMCLK       0x0200
+#define TASSEL_3            0x0300
+#define MC__STOP            0x0000
+#define MC__CONTINUOUS      0x0020
+#define TACLR               0x0004
+#define TAIFG               0x0001
+
+/// MPY32 - RESLO/RESHI follow MPY * OP2 as the hardware's do
+extern volatile unsigned int MPY, OP2;
+#define RESLO ((unsigned int)(((unsigned long)MPY * OP2) & 0xFFFF))
+#define RESHI ((unsigned int)(((unsigned long)MPY * OP2) >> 16))
+
+/// Status register
+#define GIE                 0x0008
+#define LPM3_bits           0x00D0
+extern unsigned int rtc_stub_sr;
+extern unsigned long rtc_stub_dint_count;   /* __disable_interrupt() calls so far */
+unsigned int __get_SR_register(void);
+void __disable_interrupt(void);
+void __enable_interrupt(void);
+void __no_operation(void);
+void __bis_SR_register(unsigned int bits);
+void __bic_SR_register_on_exit(unsigned int bits);
+extern unsigned long rtc_stub_wakeups;      /* __bic_SR_register_on_exit() calls so far */
+
+/// Run the RTC counter on by this many counts, raising the interrupt where it rolls over - held
+/// until interrupts are enabled again if they are masked
+void rtc_stub_count(unsigned long counts);
+
+/** Have every read of RTCCNT take RTC_STUB_READ_TICKS of a ref_hz clock, counting on TA0R while
+ *  TA0CTL has it running, and run the RTC counter at cnt_mhz/1000 counts a second meanwhile.
+ *  ref_hz 0 turns it off again.
+ */
+#define RTC_STUB_READ_TICKS 5
+void rtc_stub_gate(unsigned long ref_hz, unsigned long cnt_mhz);
+
+/// Raise the RTC counter interrupt: RTC_ISR() with RTCIV reading RTCIV_RTCIF
+void rtc_stub_tick(void);
+
+/// The interrupt function rtc_stub_tick() calls - rtckit.c's RTC_ISR() unless a test puts its own in
+void RTC_ISR(void);
+extern void (*rtc_stub_isr)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTCKIT_TEST_MSP430_H */
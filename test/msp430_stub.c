@@ -0,0 +1,160 @@
+/**
+  * MSP430 Real Time Clock Kit - host test register stub
+  *
+  * The registers and intrinsics declared in test/msp430.h.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include <msp430.h>
+
+volatile unsigned int RTCCTL, RTCIV, RTCMOD, rtc_stub_rtccnt;
+volatile unsigned int CSCTL1, CSCTL4, CSCTL5;
+volatile unsigned int SYSCFG0, PMMIFG;
+volatile unsigned char PMMCTL0_H, PMMCTL0_L;
+volatile unsigned int TA0CTL, TA0R;
+volatile unsigned int MPY, OP2;
+
+/// Interrupts start enabled, as they are in a running application
+unsigned int rtc_stub_sr = GIE;
+unsigned long rtc_stub_dint_count;
+unsigned long rtc_stub_wakeups;
+
+/// A rollover that came with interrupts masked, taken when they are enabled again
+static unsigned int held_tick;
+
+static unsigned long gate_ref_hz, gate_cnt_mhz, gate_acc;
+
+void (*rtc_stub_isr)(void) = RTC_ISR;
+
+unsigned int __get_SR_register(void)
+{
+    return rtc_stub_sr;
+}
+
+void __disable_interrupt(void)
+{
+    rtc_stub_dint_count++;
+    rtc_stub_sr &= ~GIE;
+}
+
+void __enable_interrupt(void)
+{
+    rtc_stub_sr |= GIE;
+    if (held_tick) {
+        held_tick = 0;
+        rtc_stub_tick();
+    }
+}
+
+void __no_operation(void)
+{
+}
+
+void __bis_SR_register(unsigned int bits)
+{
+    // Entering a low-power mode returns at once - there's no interrupt to wait for
+    if (bits & GIE) {
+        __enable_interrupt();
+    }
+}
+
+void __bic_SR_register_on_exit(unsigned int bits)
+{
+    (void)bits;
+    rtc_stub_wakeups++;
+}
+
+void rtc_stub_count(unsigned long counts)
+{
+    static unsigned int latched_mod;
+
+    while (counts--) {
+        if (RTCCTL & RTCSR) {
+            // Software reset: the counter starts over and takes up RTCMOD at once
+            RTCCTL &= ~RTCSR;
+            rtc_stub_rtccnt = 0;
+            latched_mod = RTCMOD & 0xFFFF;  // A 16-bit register, which a host's unsigned int isn't
+        }
+        if (rtc_stub_rtccnt >= latched_mod) {
+            // RTCMOD is buffered - a new value takes over from the next period
+            rtc_stub_rtccnt = 0;
+            latched_mod = RTCMOD & 0xFFFF;
+            if (rtc_stub_sr & GIE) {
+                rtc_stub_tick();
+            } else {
+                held_tick = 1;
+                RTCCTL |= RTCIF;
+            }
+        } else {
+            rtc_stub_rtccnt++;
+        }
+    }
+}
+
+void rtc_stub_gate(unsigned long ref_hz, unsigned long cnt_mhz)
+{
+    gate_ref_hz = ref_hz;
+    gate_cnt_mhz = cnt_mhz;
+    gate_acc = 0;
+}
+
+volatile unsigned int *rtc_stub_read_cnt(void)
+{
+    if (gate_ref_hz != 0) {
+        if (TA0CTL & TACLR) {
+            TA0CTL &= ~TACLR;
+            TA0R = 0;
+        }
+        if (TA0CTL & MC__CONTINUOUS) {
+            if (TA0R > 0xFFFF - RTC_STUB_READ_TICKS) {
+                TA0CTL |= TAIFG;
+            }
+            TA0R = (TA0R + RTC_STUB_READ_TICKS) & 0xFFFF;
+        }
+        gate_acc += RTC_STUB_READ_TICKS * gate_cnt_mhz;
+        while (gate_acc >= gate_ref_hz * 1000) {
+            gate_acc -= gate_ref_hz * 1000;
+            rtc_stub_count(1);
+        }
+    }
+    return &rtc_stub_rtccnt;
+}
+
+void rtc_stub_tick(void)
+{
+    unsigned int sr = rtc_stub_sr;
+
+    // The hardware enters an ISR with GIE clear and restores it from the stack on the way out
+    rtc_stub_sr &= ~GIE;
+    RTCCTL |= RTCIF;
+    RTCIV = RTCIV_RTCIF;
+    rtc_stub_isr();
+    RTCIV = 0;
+    RTCCTL &= ~RTCIF;
+    rtc_stub_sr = sr;
+}
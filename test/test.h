@@ -0,0 +1,60 @@
+/**
+  * MSP430 Real Time Clock Kit - host test helpers
+  *
+  * Each test is a program of its own; CHECK() counts what fails, printing the first few, and
+  * test_done() turns the count into the exit status make looks at.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#ifndef RTCKIT_TEST_H
+#define RTCKIT_TEST_H
+#include <stdio.h>
+
+/// Failures printed before the rest are only counted
+#define TEST_MAX_PRINTED 20
+
+static unsigned long test_checks, test_failures;
+
+static void test_fail(const char *file, int line, const char *what, unsigned long value)
+{
+    if (++test_failures <= TEST_MAX_PRINTED) {
+        printf("%s:%d: FAILED %s (at %lu)\n", file, line, what, value);
+    }
+}
+
+/// Check a condition; value - an epoch, an index - is printed with a failure to find it again
+#define CHECK(cond, value) \
+    do { test_checks++; if (!(cond)) { test_fail(__FILE__, __LINE__, #cond, (unsigned long)(value)); } } while (0)
+
+static int test_done(const char *name)
+{
+    printf("%s: %lu checks, %lu failed\n", name, test_checks, test_failures);
+    return test_failures != 0;
+}
+
+#endif /* RTCKIT_TEST_H */
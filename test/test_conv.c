@@ -0,0 +1,348 @@
+/**
+  * MSP430 Real Time Clock Kit - conversion round trip
+  *
+  * Every day from Jan 1 1970 to the end of the 32-bit epoch, at midnight, at 23:59:59 and at
+  * a second that moves through the day, is converted with the library and with the host's
+  * gmtime_r()/timegm(), and everything that goes from an epoch to a date or a string is
+  * checked against the way back: rtc_interpret*(), rtc_batch_next(), rtc_epoch(),
+  * rtc_normalize(), rtc_dt_epoch(), RTC_EPOCH(), the formatters and the three parsers.
+  * rtc_normalize() and the date arithmetic helpers are then driven with out-of-range fields.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rtckit.h"
+#include "test.h"
+
+/// Last day number whose midnight an unsigned long epoch holds, Feb 7 2106
+#define LAST_DAY 49710UL
+
+static int same_tm(const struct tm *r, const struct tm *g)
+{
+    return r->tm_year == g->tm_year + 1900 && r->tm_mon == g->tm_mon && r->tm_mday == g->tm_mday &&
+           r->tm_hour == g->tm_hour && r->tm_min == g->tm_min && r->tm_sec == g->tm_sec &&
+           r->tm_wday == g->tm_wday && r->tm_yday == g->tm_yday;
+}
+
+static int same_dt(const struct rtc_datetime *dt, const struct tm *g)
+{
+    return dt->year == (unsigned int)g->tm_year + 1900 && dt->mon == g->tm_mon &&
+           dt->mday == g->tm_mday && dt->hour == g->tm_hour && dt->min == g->tm_min &&
+           dt->sec == g->tm_sec && dt->wday == g->tm_wday && dt->yday == (unsigned int)g->tm_yday;
+}
+
+static int same_dt_dt(const struct rtc_datetime *a, const struct rtc_datetime *b)
+{
+    return a->year == b->year && a->yday == b->yday && a->mon == b->mon && a->mday == b->mday &&
+           a->hour == b->hour && a->min == b->min && a->sec == b->sec && a->wday == b->wday;
+}
+
+/// Feed a whole NMEA sentence, checksum appended, and return what the last character gave
+static int nmea_sentence(struct rtcNmeaParser *p, const char *body, unsigned long *epoch)
+{
+    char line[96];
+    unsigned int sum = 0;
+    const char *c;
+    int r = 0;
+
+    for (c = body; *c; c++) {
+        sum ^= (unsigned char)*c;
+    }
+    snprintf(line, sizeof line, "$%s*%02X\r\n", body, sum);
+    for (c = line; *c; c++) {
+        r |= rtc_nmea_feed(p, *c, epoch);
+    }
+    return r;
+}
+
+static void check_epoch(unsigned long e, struct rtcBatch *batch, struct rtcNmeaParser *nmea)
+{
+    time_t t = (time_t)e;
+    struct tm g, r, c;
+    struct rtc_datetime dt;
+    char want[80], got[48];
+    unsigned long back;
+
+    gmtime_r(&t, &g);
+
+    CHECK(same_tm(rtc_interpret(e), &g), e);
+    CHECK(same_tm(rtc_interpret_r(e, &r), &g), e);
+    CHECK(same_dt(rtc_interpret_dt(e, &dt), &g), e);
+    CHECK(same_dt(rtc_batch_next(batch, e), &g), e);
+    CHECK(rtc_dt_epoch(&dt) == e, e);
+    CHECK(RTC_EPOCH(g.tm_year + 1900, g.tm_mon + 1, g.tm_mday, g.tm_hour, g.tm_min, g.tm_sec) == e, e);
+
+    // rtc_epoch() from the date, and from tm_yday alone
+    c = g;
+    c.tm_year += 1900;
+    c.tm_yday = 0;
+    CHECK(rtc_epoch(&c) == e, e);
+    c.tm_mon = 0;
+    c.tm_mday = 0;
+    c.tm_yday = g.tm_yday;
+    CHECK(rtc_epoch(&c) == e, e);
+
+    c = g;
+    c.tm_year += 1900;
+    c.tm_wday = c.tm_yday = 0;
+    CHECK(rtc_normalize(&c) == e && same_tm(&c, &g), e);
+
+    // ISO 8601 and HTTP-date, out and back
+    snprintf(want, sizeof want, "%04d-%02d-%02dT%02d:%02d:%02dZ", g.tm_year + 1900, g.tm_mon + 1,
+             g.tm_mday, g.tm_hour, g.tm_min, g.tm_sec);
+    CHECK(rtc_format_iso8601(e, got) == RTC_ISO8601_LEN && strcmp(got, want) == 0, e);
+    CHECK(rtc_parse_iso8601(got, &back) == 0 && back == e, e);
+
+    strftime(want, sizeof want, "%a, %d %b %Y %H:%M:%S GMT", &g);
+    CHECK(rtc_strftime(got, sizeof got, "%a, %d %b %Y %H:%M:%S GMT", &r) == strlen(want) &&
+          strcmp(got, want) == 0, e);
+    CHECK(rtc_parse_http_date(got, &back) == 0 && back == e, e);
+
+    // NMEA reads two-digit years as 1980-2079
+    if (g.tm_year >= 80 && g.tm_year < 180) {
+        snprintf(want, sizeof want, "GPRMC,%02d%02d%02d.00,A,4807.038,N,01131.000,E,0.0,0.0,%02d%02d%02d,,",
+                 g.tm_hour, g.tm_min, g.tm_sec, g.tm_mday, g.tm_mon + 1, g.tm_year % 100);
+        back = 0;
+        CHECK(nmea_sentence(nmea, want, &back) == 1 && back == e, e);
+    }
+}
+
+/// rtc_normalize() against timegm() with fields out of range in both directions
+static void check_normalize(void)
+{
+    unsigned long i, e;
+    struct tm a, g;
+    time_t t;
+
+    srand(1);
+    for (i = 0; i < 2000000UL; i++) {
+        memset(&a, 0, sizeof a);
+        a.tm_year = 1969 + rand() % 140;
+        a.tm_mon = rand() % 40 - 14;
+        a.tm_mday = rand() % 80 - 30;
+        a.tm_hour = rand() % 60 - 20;
+        a.tm_min = rand() % 200 - 70;
+        a.tm_sec = rand() % 200 - 70;
+        a.tm_yday = 77;
+        a.tm_wday = 9;
+        g = a;
+        g.tm_year -= 1900;
+        t = timegm(&g);
+
+        e = rtc_normalize(&a);
+        if (t <= 0 || t > 0xFFFFFFFFL) {
+            CHECK(e == 0, i);
+        } else {
+            CHECK(e == (unsigned long)t && same_tm(&a, &g), i);
+        }
+    }
+}
+
+/// The date arithmetic helpers against timegm()
+static void check_helpers(void)
+{
+    struct rtc_datetime dt, a, w;
+    unsigned long e, sow;
+    unsigned int wd;
+    long long want;
+    int k, dim;
+    struct tm g;
+
+    for (e = 0; e < 0xFFFFFFFFUL - 12345677UL; e += 12345677UL) {
+        rtc_interpret_dt(e, &dt);
+
+        CHECK(rtc_next_midnight(e) > e && rtc_next_midnight(e) - e <= 86400 &&
+              rtc_next_midnight(e) % 86400 == 0, e);
+        for (wd = 0; wd < 7; wd++) {
+            sow = rtc_start_of_week(e, wd);
+            if (e < 7 * 86400UL && sow == 0) {
+                continue;  // The week began in 1969
+            }
+            rtc_interpret_dt(sow, &w);
+            CHECK(sow % 86400 == 0 && w.wday == wd && sow <= e && e - sow < 7 * 86400UL, e);
+            CHECK(rtc_start_of_week(e, wd + 7) == sow && rtc_start_of_week(e, wd + 7 * 9000) == sow, e);
+        }
+
+        for (k = -400; k <= 400; k += 37) {
+            a = dt;
+            want = (long long)e + k * 86400LL;
+            if (want < 0 || want > 0xFFFFFFFFLL) {
+                continue;
+            }
+            CHECK(rtc_add_days(&a, k) == 0, e);
+            rtc_interpret_dt((unsigned long)want, &w);
+            CHECK(same_dt_dt(&a, &w), e);
+        }
+
+        for (k = -30; k <= 30; k += 7) {
+            a = dt;
+            if (rtc_add_months(&a, k) != 0) {
+                CHECK(dt.year + (dt.mon + k) / 12 < 1971 || dt.year + (dt.mon + k) / 12 > 2105, e);
+                continue;
+            }
+            memset(&g, 0, sizeof g);
+            g.tm_year = dt.year - 1900;
+            g.tm_mon = dt.mon + k + 1;
+            g.tm_mday = 0;  // Last day of the month we want
+            timegm(&g);
+            dim = g.tm_mday;
+            g.tm_mday = dt.mday > dim ? dim : dt.mday;
+            timegm(&g);
+            CHECK(a.year == (unsigned int)g.tm_year + 1900 && a.mon == g.tm_mon && a.mday == g.tm_mday &&
+                  a.yday == (unsigned int)g.tm_yday && a.wday == g.tm_wday && a.hour == dt.hour &&
+                  a.min == dt.min && a.sec == dt.sec, e);
+        }
+    }
+}
+
+/// rtc_epoch() at the last second an unsigned long holds, and turning down the rest of 2106
+static void check_epoch_range(void)
+{
+    static const int last[][4] = { { 1, 7, 6, 28 }, { 1, 7, 6, 29 }, { 1, 8, 0, 0 }, { 11, 31, 23, 59 } };
+    struct tm t;
+    unsigned int i;
+
+    for (i = 0; i < sizeof last / sizeof last[0]; i++) {
+        memset(&t, 0, sizeof t);
+        t.tm_year = 2106;
+        t.tm_mon = last[i][0];
+        t.tm_mday = last[i][1];
+        t.tm_hour = last[i][2];
+        t.tm_min = last[i][3];
+        t.tm_sec = 15;
+        CHECK(rtc_epoch(&t) == (i == 0 ? 0xFFFFFFFFUL : 0), i);
+        t.tm_sec = 16;
+        CHECK(rtc_epoch(&t) == 0, i);
+    }
+    memset(&t, 0, sizeof t);
+    t.tm_year = 2106;
+    t.tm_yday = 37;  // Feb 7, from tm_yday alone
+    t.tm_hour = 6;
+    t.tm_min = 28;
+    t.tm_sec = 15;
+    CHECK(rtc_epoch(&t) == 0xFFFFFFFFUL, t.tm_yday);
+    t.tm_yday = 38;
+    t.tm_hour = t.tm_min = t.tm_sec = 0;
+    CHECK(rtc_epoch(&t) == 0, t.tm_yday);
+}
+
+/// Malformed input the parsers must turn down, next to the nearest form they accept
+static void check_parse_errors(void)
+{
+    static const char *const iso_bad[] =
+    {
+        "2026-10-14T09:30:00+02:", "2026-10-14T09:30:00+02:3", "2026-10-14T09:30:00+0",
+        "2026-10-14T09:30:00.", "2026-10-14T09:30:00+24", "2026-10-14T09:30:00+02:60"
+    };
+    static const char *const rmc_bad[] = { "123519.x4", "123519.", "123519,", "1235x9" };
+    static const char *const rmc_status_bad[] = { "VA", "AV", "AA", "V", "" };
+    struct rtcNmeaParser nmea;
+    char body[96];
+    unsigned long e;
+    unsigned int i;
+
+    for (i = 0; i < sizeof iso_bad / sizeof iso_bad[0]; i++) {
+        CHECK(rtc_parse_iso8601(iso_bad[i], &e) == -1, i);
+    }
+    CHECK(rtc_parse_iso8601("2026-10-14T09:30:00+02", &e) == 0 && e == 1791963000UL, e);
+    CHECK(rtc_parse_iso8601("2026-10-14T09:30:00+0230", &e) == 0 && e == 1791961200UL, e);
+    CHECK(rtc_parse_iso8601("2026-10-14T09:30:00-02:30", &e) == 0 && e == 1791979200UL, e);
+
+    rtc_nmea_init(&nmea);
+    for (i = 0; i < sizeof rmc_bad / sizeof rmc_bad[0]; i++) {
+        snprintf(body, sizeof body, "GPRMC,%s,A,4807.038,N,01131.000,E,0.0,0.0,141026,,", rmc_bad[i]);
+        e = 0;
+        CHECK(nmea_sentence(&nmea, body, &e) == 0 && e == 0, i);
+    }
+    for (i = 0; i < sizeof rmc_status_bad / sizeof rmc_status_bad[0]; i++) {
+        snprintf(body, sizeof body, "GPRMC,093000,%s,4807.038,N,01131.000,E,0.0,0.0,141026,,", rmc_status_bad[i]);
+        e = 0;
+        CHECK(nmea_sentence(&nmea, body, &e) == 0 && e == 0, i);
+    }
+    CHECK(nmea_sentence(&nmea, "GPRMC,093000.25,A,4807.038,N,01131.000,E,0.0,0.0,141026,,", &e) == 1 &&
+          e == 1791970200UL, e);
+    CHECK(nmea_sentence(&nmea, "GPRMC,093000,A,4807.038,N,01131.000,E,0.0,0.0,141026,,", &e) == 1 &&
+          e == 1791970200UL, e);
+}
+
+/// rtc_strftime() turns down a struct tm with any field out of range rather than reading past its tables
+static void check_strftime_range(void)
+{
+    static const int bad[][2] =
+    {
+        { 0, -1 }, { 0, 10000 }, { 1, -1 }, { 1, 12 }, { 2, 0 }, { 2, 32 }, { 3, -1 }, { 3, 24 },
+        { 4, 60 }, { 5, 61 }, { 6, -1 }, { 6, 366 }, { 7, -1 }, { 7, 7 }
+    };
+    struct tm t;
+    int *const field[] = { &t.tm_year, &t.tm_mon, &t.tm_mday, &t.tm_hour, &t.tm_min, &t.tm_sec,
+                           &t.tm_yday, &t.tm_wday };
+    char got[64];
+    unsigned int i;
+
+    for (i = 0; i < sizeof bad / sizeof bad[0]; i++) {
+        t = *rtc_interpret(1791970200UL);
+        *field[bad[i][0]] = bad[i][1];
+        CHECK(rtc_strftime(got, sizeof got, "%a %B %F %T", &t) == 0, i);
+    }
+    t = *rtc_interpret(1791970200UL);
+    t.tm_sec = 60;
+    CHECK(rtc_strftime(got, sizeof got, "%a %B %F %T", &t) == 31 &&
+          strcmp(got, "Wed October 2026-10-14 09:30:60") == 0, t.tm_sec);
+}
+
+int main(void)
+{
+    struct rtcBatch batch;
+    struct rtcNmeaParser nmea;
+    unsigned long day, sod[3], e;
+    unsigned int i;
+
+    rtc_batch_init(&batch);
+    rtc_nmea_init(&nmea);
+    for (day = 0; day <= LAST_DAY; day++) {
+        sod[0] = 0;
+        sod[1] = (day * 7919UL) % 86400UL;
+        sod[2] = 86399;
+        for (i = 0; i < 3; i++) {
+            e = day * 86400UL + sod[i];
+            if (day == LAST_DAY && sod[i] > 23295) {
+                e = 0xFFFFFFFFUL;  // The last second there is
+            }
+            check_epoch(e, &batch, &nmea);
+        }
+    }
+    check_normalize();
+    check_helpers();
+    check_epoch_range();
+    check_parse_errors();
+    check_strftime_range();
+    return test_done("test_conv");
+}
@@ -0,0 +1,311 @@
+/**
+  * MSP430 Real Time Clock Kit - RTC_ISR and the timekeeping API on the register stub
+  *
+  * rtckit.c built for the host against test/msp430.h.  The RTC counter is run count by count
+  * with rtc_stub_count() - prescaled counts, rtc_ticks_per_second() of them a second - so
+  * every RTC_ISR the hardware would raise is raised here, in order.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include <stdlib.h>
+#include <msp430.h>
+#include "rtckit.h"
+#include "rtckit_arith.h"
+#include "test.h"
+
+/// The time never goes backwards and rtc_now_ticks() agrees with rtc_get_epoch()
+static void check_ticking(void)
+{
+    unsigned long last = 0, e, v, k;
+    unsigned int t, cps;
+
+    CHECK(rtc_init_ex(RTC_CLOCK_XT1CLK, 0, 4, NULL) == 0, 4);
+    rtc_set_epoch(1000);
+    cps = rtc_ticks_per_second();
+    for (k = 0; k < cps * 3UL; k++) {
+        e = rtc_now_ticks(&t);
+        v = e * cps + t;
+        CHECK(t < cps && e == rtc_get_epoch(), k);
+        CHECK(k == 0 || v == last || v == last + 1, k);
+        last = v;
+        rtc_stub_count(1);
+    }
+    CHECK(rtc_get_epoch() == 1003, rtc_get_epoch());
+}
+
+/// Alarm table: one-shot, periodic and past-due alarms trigger on the right tick
+static void check_alarms(void)
+{
+    unsigned int i, cps, fired3 = 0, fired1 = 0;
+
+    rtc_init(RTC_CLOCK_XT1CLK);
+    cps = rtc_ticks_per_second();
+    rtc_set_epoch(1000);
+    rtc_alarm_triggered = 0;
+    CHECK(rtc_alarm_set(3, 1005, 0) == 0, 3);
+    CHECK(rtc_alarm_set(1, 1002, 3) == 0, 1);
+    CHECK(rtc_alarm_set(0, 900, 0) == 0, 0);
+    CHECK(rtc_alarm_set(RTCKIT_ALARM_TABLE_SIZE, 1100, 0) == -1, RTCKIT_ALARM_TABLE_SIZE);
+    CHECK(rtc_alarm_next() == 900, rtc_alarm_next());
+
+    rtc_stub_count(cps);
+    CHECK(rtc_alarm_triggered & (1u << 0), rtc_get_epoch());
+    for (i = 0; i < 10; i++) {
+        rtc_alarm_triggered = 0;
+        rtc_stub_count(cps);
+        if (rtc_alarm_triggered & (1u << 3)) {
+            CHECK(rtc_get_epoch() == 1005, rtc_get_epoch());
+            fired3++;
+        }
+        if (rtc_alarm_triggered & (1u << 1)) {
+            CHECK((rtc_get_epoch() - 1002) % 3 == 0, rtc_get_epoch());
+            fired1++;
+        }
+    }
+    CHECK(fired3 == 1 && fired1 == 4, fired1);
+    rtc_alarm_cancel(1);
+    rtc_alarm_cancel(3);
+}
+
+/// A local-time rule searched from the first hours of the epoch, either side of UTC
+static void check_rule_1970(void)
+{
+    static const struct rtcCalRule noon = { 0, 0, 0, 12, 0, 0, RTC_CAL_LOCAL };
+    static const struct rtcCalRule early = { 0, 0, 0, 0, 30, 0, RTC_CAL_LOCAL };
+    struct rtcTimezone tz;
+
+    // New York: Jan 1 1970 local starts at 05:00 UTC, so "after" is still Dec 31 1969 there
+    CHECK(rtc_tz_parse("EST5EDT,M3.2.0,M11.1.0", &tz) == 0, 0);
+    rtc_tz_set(&tz);
+    CHECK(rtc_cal_next(&noon, 0) == 17 * 3600UL, rtc_cal_next(&noon, 0));
+    CHECK(rtc_cal_next(&noon, 3600) == 17 * 3600UL, rtc_cal_next(&noon, 3600));
+    CHECK(rtc_cal_next(&early, 100) == 5 * 3600UL + 1800, rtc_cal_next(&early, 100));
+
+    // Berlin: 00:30 on Jan 1 1970 local was Dec 31 1969 UTC, so the first match is a day on
+    CHECK(rtc_tz_parse("CET-1CEST,M3.5.0,M10.5.0/3", &tz) == 0, 0);
+    rtc_tz_set(&tz);
+    CHECK(rtc_cal_next(&early, 0) == 86400UL - 1800, rtc_cal_next(&early, 0));
+    CHECK(rtc_cal_next(&noon, 0) == 11 * 3600UL, rtc_cal_next(&noon, 0));
+
+    CHECK(rtc_tz_parse("UTC0", &tz) == 0, 0);
+    rtc_tz_set(&tz);
+}
+
+/// A rule alarm is re-armed by rtc_dispatch(), not by RTC_ISR - also after a step back in time
+static void check_rule_alarm(void)
+{
+    static const struct rtcCalRule noon = { 0, 0, 0, 12, 0, 0, 0 };
+    unsigned long when;
+    unsigned int cps;
+
+    rtc_init(RTC_CLOCK_XT1CLK);
+    cps = rtc_ticks_per_second();
+    rtc_set_epoch(1000000000UL);
+    CHECK(rtc_alarm_set_rule(2, &noon) == 0, 2);
+    when = rtc_alarm_get(2);
+    CHECK(when == rtc_cal_next(&noon, 1000000000UL) && when % 86400 == 43200, when);
+
+    rtc_set_epoch(when - 1);
+    rtc_alarm_triggered = 0;
+    rtc_stub_count(cps);
+    CHECK(rtc_alarm_triggered & (1u << 2), rtc_get_epoch());
+    CHECK(rtc_alarm_get(2) == when && rtc_alarm_next() == 0, rtc_alarm_get(2));
+    rtc_dispatch();
+    CHECK(rtc_alarm_get(2) == when + 86400 && rtc_alarm_next() == when + 86400, rtc_alarm_get(2));
+
+    // Stepped back, it keeps its match until rtc_dispatch() finds the earlier one
+    rtc_set_epoch(when - 10);
+    CHECK(rtc_alarm_get(2) == when + 86400, rtc_alarm_get(2));
+    rtc_dispatch();
+    CHECK(rtc_alarm_get(2) == when, rtc_alarm_get(2));
+
+    // Cancelled before rtc_dispatch() gets to it, it stays cancelled
+    rtc_set_epoch(when - 1);
+    rtc_stub_count(cps);
+    rtc_alarm_cancel(2);
+    rtc_dispatch();
+    CHECK(rtc_alarm_get(2) == 0 && rtc_alarm_next() == 0, rtc_alarm_get(2));
+}
+
+/// rtc_set_time_precise() starts the next second subsec counts from now
+static void check_precise(void)
+{
+    unsigned int t, cps;
+
+    rtc_init(RTC_CLOCK_XT1CLK);
+    cps = rtc_ticks_per_second();
+    rtc_stub_count(1234);
+    CHECK(rtc_set_time_precise(5000, 0) == 0, 0);
+    rtc_stub_count(cps - 1);
+    CHECK(rtc_now_ticks(&t) == 5000 && t == cps - 1, t);
+    rtc_stub_count(1);
+    CHECK(rtc_now_ticks(&t) == 5001 && t == 0, t);
+    CHECK(rtc_set_time_precise(5000, cps) == -1, cps);
+}
+
+/// rtc_init_ex() reports the error of the rate it picked to within 1ppm of the exact figure
+static void check_init_ppm(void)
+{
+    static const unsigned int divs[8] = { 1, 10, 16, 64, 100, 256, 1000, 1024 };
+    static const unsigned int ticks[] = { 1, 2, 3, 10, 64, 100, 1000, 1024 };
+    unsigned long hz, rate, off;
+    unsigned int i, cps;
+    long err, want;
+
+    for (hz = 9000; hz < 25000000UL; hz += hz / 7 + 13) {
+        for (i = 0; i < sizeof(ticks) / sizeof(ticks[0]); i++) {
+            err = 0x7FFFFFFFL;
+            if (rtc_init_ex(RTC_CLOCK_SMCLK, hz, ticks[i], &err) != 0 || err == 0x7FFFFFFFL) {
+                continue;
+            }
+            cps = rtc_ticks_per_second();
+            rate = (unsigned long)cps * divs[(RTCCTL & 0x0700) >> 8];
+            off = (hz > rate) ? hz - rate : rate - hz;
+            want = (long)(((unsigned long long)off * 1000000 + rate / 2) / rate);
+            if (hz < rate) {
+                want = -want;
+            }
+            CHECK(labs(err - want) <= 1, hz);
+        }
+    }
+}
+
+/// rtc_adjtime() scales as the 64-bit formula would, clamps at 32767 seconds, and slews fully
+static void check_adjtime(void)
+{
+    unsigned long k;
+    unsigned int t, cps;
+    long d, slew;
+
+    rtc_init(RTC_CLOCK_XT1CLK);
+    cps = rtc_ticks_per_second();
+    CHECK(rtc_adjtime(0) == 0, 0);
+    for (d = -32767999L; d <= 32767999L; d += 4093) {
+        rtc_adjtime(d);
+        slew = (long)((long long)d * cps / 1000);
+        CHECK(rtc_adjtime(0) == (long)((long long)slew * 1000 / cps), d);
+    }
+    rtc_adjtime(40000000L);
+    CHECK(rtc_adjtime(-40000000L) == 32767000L, 0);
+    CHECK(rtc_adjtime(0) == -32767000L, 0);
+
+    rtc_set_epoch(100);
+    rtc_adjtime(250);
+    for (k = 0; k < 3600UL * cps; k += cps) {
+        rtc_stub_count(cps);
+    }
+    CHECK(rtc_adjtime(0) == 0, 0);
+    CHECK(rtc_now_ticks(&t) == 3700 && t == (unsigned int)(250L * cps / 1000), t);
+}
+
+/// rtc_vlo_calibrate() measures a VLO that is off, and the trim then keeps time - also tickless
+/// with a slew running, where the longest period must still fit RTCMOD
+static void check_vlo_calibrate(void)
+{
+    unsigned long e0, hz;
+    unsigned int i;
+
+    rtc_init(RTC_CLOCK_XT1CLK);
+    CHECK(rtc_vlo_calibrate(RTC_CLOCK_SMCLK, 1000000UL, 50) == 0, 0);
+
+    // 9360.99Hz: the trim adds nearly a count a second, and the longest tickless period
+    // together with a slew the other way comes within a few counts of what RTCMOD holds
+    for (i = 0; i < RTCKIT_ALARM_TABLE_SIZE; i++) {
+        rtc_alarm_cancel(i);
+    }
+    rtcalarm0 = rtcalarm1 = 0;
+    CHECK(rtc_init_preset(RTC_CLOCK_VLOCLK | RTC_INIT_TICKLESS, 1, 10000, 1) == 0, 0);
+    rtc_set_epoch(5000);
+    rtc_stub_count(1);
+    rtc_stub_gate(1000000UL, 9360990UL);
+    hz = rtc_vlo_calibrate(RTC_CLOCK_SMCLK, 1000000UL, 0xFFFF);
+    rtc_stub_gate(0, 0);
+    CHECK(hz >= 9360 && hz <= 9362, hz);
+    CHECK(rtc_stub_sr == GIE, rtc_stub_sr);
+
+    e0 = rtc_get_epoch();
+    rtc_adjtime(-1000);
+    rtc_stub_count(33699564UL);  // An hour
+    CHECK(rtc_adjtime(0) == 0, 0);
+    CHECK(rtc_get_epoch() - e0 >= 3598 && rtc_get_epoch() - e0 <= 3600, rtc_get_epoch() - e0);
+}
+
+/// rtc_mul16() on the MPY32 leaves GIE as it found it, and doesn't touch it with GIE clear
+static void check_mul16(void)
+{
+    unsigned long a, b, dints;
+
+    for (a = 0; a < 0x10000UL; a += 251) {
+        for (b = 0; b < 0x10000UL; b += 257) {
+            rtc_stub_sr = GIE;
+            CHECK(rtc_mul16(a, b) == a * b && rtc_stub_sr == GIE, a);
+        }
+    }
+    rtc_stub_sr = 0;
+    dints = rtc_stub_dint_count;
+    CHECK(rtc_mul16(0xFFFF, 0xFFFF) == 0xFFFE0001UL && rtc_stub_sr == 0, 0);
+    CHECK(rtc_stub_dint_count == dints, rtc_stub_dint_count - dints);
+    rtc_stub_sr = GIE;
+}
+
+/// rtc_div64_32() against the 64-bit divide, for random dividends with hi < d
+static void check_div64(void)
+{
+    unsigned long long n;
+    unsigned long hi, lo, d, k;
+
+    srand(20);
+    for (k = 0; k < 1000000UL; k++) {
+        d = ((unsigned long)rand() << 17 ^ (unsigned long)rand() << 3 ^ (unsigned long)rand()) & 0xFFFFFFFFUL;
+        d >>= rand() % 32;
+        if (d == 0) {
+            d = 1;
+        }
+        hi = (((unsigned long)rand() << 16) ^ (unsigned long)rand()) % d;
+        lo = (((unsigned long)rand() << 17) ^ (unsigned long)rand()) & 0xFFFFFFFFUL;
+        n = ((unsigned long long)hi << 32) | lo;
+        CHECK(rtc_div64_32(hi, lo, d) == n / d, k);
+    }
+    CHECK(rtc_div64_32(0xFFFFFFFEUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL) == 0xFFFFFFFFUL, 0);
+    CHECK(rtc_div64_32(0x80000000UL, 0, 0x80000001UL) == 0xFFFFFFFEUL, 0);
+}
+
+int main(void)
+{
+    check_mul16();
+    check_div64();
+    check_init_ppm();
+    check_ticking();
+    check_alarms();
+    check_rule_alarm();
+    check_rule_1970();
+    check_precise();
+    check_adjtime();
+    check_vlo_calibrate();
+    return test_done("test_core");
+}
@@ -0,0 +1,149 @@
+/**
+  * MSP430 Real Time Clock Kit - the C++ front-end on the register stub
+  *
+  * Rtc<> types with and without features are started with init() and checked against what
+  * rtc_init_ex() programs, then their isr() is run in place of the C RTC_ISR: the listed
+  * features must behave as in the C one, and those left out must not run at all.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+
+#include <msp430.h>
+#include "rtckit.hpp"
+#include "test.h"
+
+using rtckit::Clock;
+using rtckit::Feature;
+
+/// Only the alarm table - no day count, no legacy alarms, no tick handler
+using Lean = rtckit::Rtc<Clock::XT1, 0, 1, 2>;
+/// All but tickless mode, at 4 ticks a second
+using Full = rtckit::Rtc<Clock::XT1, 0, 4, RTCKIT_ALARM_TABLE_SIZE,
+                         Feature::DaySec, Feature::LegacyAlarms, Feature::Callbacks>;
+/// A tick rate from SMCLK that only some prescalers give
+using Fast = rtckit::Rtc<Clock::SMCLK, 8000000, 1000, 0>;
+using Odd = rtckit::Rtc<Clock::SMCLK, 23987651, 3, 0>;
+
+static_assert(Lean::uses(Feature::Tickless) == false && Full::uses(Feature::DaySec));
+static_assert(!Lean::lean && !Full::lean, "the default rtckit.h compiles in more than either lists");
+
+/// What RTCKIT_ISR(Type) puts on the vector
+template <class Type> static void isr()
+{
+    if (Type::isr() & RTC_ISR_WAKEUP) {
+        __bic_SR_register_on_exit(LPM3_bits);
+    }
+}
+
+static unsigned int handled;
+
+static void on_tick(unsigned int event, unsigned long epoch)
+{
+    (void)event;
+    (void)epoch;
+    handled++;
+}
+
+/// init() programs what rtc_init_ex() would have, and reports the same error
+template <class Type> static void check_init(unsigned int source)
+{
+    unsigned int ctl, mod, cps;
+    long err = 0;
+
+    CHECK(rtc_init_ex(source, Type::source_hz, Type::tick_hz, &err) == 0, source);
+    ctl = RTCCTL;
+    mod = RTCMOD;
+    cps = rtc_ticks_per_second();
+    CHECK(Type::init() == 0, source);
+    CHECK(RTCCTL == ctl && RTCMOD == mod && rtc_ticks_per_second() == cps, Type::counts);
+    CHECK(Type::error_ppm == err, err);
+}
+
+struct Outcome
+{
+    unsigned long epoch, wakeups;
+    unsigned int day, status, handled, triggered;
+};
+
+/// Run across a midnight with a legacy alarm, a table alarm and a tick handler set
+template <class Type> static Outcome run(void (*fn)(void))
+{
+    Outcome o;
+
+    Type::init();
+    rtc_stub_isr = fn;
+    rtc_set_epoch(100 * 86400UL - 2);
+    rtc_status = 0;
+    rtc_alarm_triggered = 0;
+    rtcalarm0 = 100 * 86400UL + 1;
+    rtcalarm0_incr = 0;
+    Type::template alarm<1>(100 * 86400UL + 2);
+    rtc_on_tick(on_tick, 0);
+    handled = 0;
+    rtc_stub_wakeups = 0;
+    rtc_stub_count(5UL * rtc_ticks_per_second());
+    rtc_dispatch();
+
+    o.epoch = rtc_get_epoch();
+    o.wakeups = rtc_stub_wakeups;
+    o.day = rtc_day;
+    o.status = rtc_status & (RTCALARM_0_TRIGGERED | RTCALARM_TABLE_TRIGGERED);
+    o.handled = handled;
+    o.triggered = rtc_alarm_triggered;
+    rtc_on_tick(0, 0);
+    rtcalarm0 = 0;
+    rtc_stub_isr = RTC_ISR;
+    return o;
+}
+
+static void check_isr()
+{
+    Outcome lean = run<Lean>(isr<Lean>), full = run<Full>(isr<Full>), c = run<Full>(RTC_ISR);
+
+    // Everything listed works as it does in the C RTC_ISR...
+    CHECK(full.epoch == c.epoch && full.day == c.day && full.status == c.status, full.epoch);
+    CHECK(full.handled == c.handled && full.wakeups == c.wakeups && full.triggered == c.triggered,
+          full.wakeups);
+    CHECK(full.epoch == 100 * 86400UL + 3 && full.day == 100 && full.handled == 5, full.handled);
+
+    // ...and what isn't listed never runs: the day count stands still, rtcalarm0 and the tick
+    // handler are left alone, and only the table alarm wakes the chip
+    CHECK(lean.epoch == 100 * 86400UL + 3 && lean.day == 99, lean.day);
+    CHECK(lean.status == RTCALARM_TABLE_TRIGGERED && lean.triggered == (1u << 1), lean.status);
+    CHECK(lean.handled == 0 && lean.wakeups == 1, lean.wakeups);
+}
+
+int main()
+{
+    check_init<Lean>(RTC_CLOCK_XT1CLK);
+    check_init<Full>(RTC_CLOCK_XT1CLK);
+    check_init<Fast>(RTC_CLOCK_SMCLK);
+    check_init<Odd>(RTC_CLOCK_SMCLK);
+    check_isr();
+    return test_done("test_hpp");
+}
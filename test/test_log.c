@@ -0,0 +1,134 @@
+/**
+  * MSP430 Real Time Clock Kit - timestamp log round trip
+  *
+  * Records with random gaps - some too long for a difference, some going backwards - are
+  * written to small logs of each layout until the ring has wrapped many times, in batches and
+  * one by one, and read back as they go and afresh at the end: the first reader must see every
+  * record in order, the second the newest ones the ring still holds.
+  * Clearing the kept stamp between writes stands in for a reset that cut a write short.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <msp430.h>
+#include "rtckit.h"
+#include "test.h"
+
+#define RECORDS 20000
+#define BATCH 7
+
+static unsigned long epochs[RECORDS];
+static unsigned int ticks[RECORDS];
+static unsigned char data[RECORDS][3];
+/// Room for more blocks than a batch can start, so the reader keeping pace is never dropped
+static unsigned char buf[4096];
+
+/// The next stamp after e/t: mostly close, now and then far ahead or behind
+static void next_stamp(unsigned long *e, unsigned int *t, unsigned int tps)
+{
+    unsigned int r = rand() % 100;
+
+    if (r < 2) {
+        *e -= rand() % 1000;
+    } else if (r < 5) {
+        *e += 256 + rand() % 100000;
+    } else {
+        *e += rand() % ((r < 60) ? 2 : 300);
+    }
+    *t = rand() % tps;
+}
+
+static void check_layout(unsigned int flags, unsigned int per_block)
+{
+    struct rtcLog log = {0};
+    struct rtcLogCursor cur;
+    unsigned long e = 1000000000UL, got_epoch;
+    unsigned int t = 0, got_ticks, tps = rtc_ticks_per_second(), i, n, k, first = 0;
+    unsigned char got_data[3];
+
+    CHECK(rtc_log_init(&log, buf, sizeof(buf), 3, per_block, flags) == 0, flags);
+    for (i = 0; i < RECORDS; i++) {
+        next_stamp(&e, &t, tps);
+        epochs[i] = e;
+        ticks[i] = (flags & RTC_LOG_TICKS) ? t : 0;
+        data[i][0] = (unsigned char)i;
+        data[i][1] = (unsigned char)(i >> 8);
+        data[i][2] = (unsigned char)flags;
+    }
+
+    // A reader keeping pace sees every record; one starting afresh just the newest
+    rtc_log_rewind(&log, &cur);
+    for (i = k = 0; i < RECORDS; i += n) {
+        n = (i % 3 == 0) ? 1 : BATCH;
+        if (n > RECORDS - i) {
+            n = RECORDS - i;
+        }
+        if (i % 11 == 0) {
+            log.last_count = 0;         // As if a reset cut the last write short
+            log.last_epoch = 0xDEADBEEFUL;
+        }
+        rtc_log_write(&log, &epochs[i], &ticks[i], data[i], n);
+        while (rtc_log_read(&log, &cur, &got_epoch, &got_ticks, got_data, 1) == 1) {
+            CHECK(k < RECORDS && got_epoch == epochs[k] && got_ticks == ticks[k] &&
+                  memcmp(got_data, data[k], 3) == 0, k);
+            k++;
+        }
+        CHECK(k == i + n, k);
+    }
+
+    rtc_log_rewind(&log, &cur);
+    for (k = 0; rtc_log_read(&log, &cur, &got_epoch, &got_ticks, got_data, 1) == 1; k++) {
+        if (k == 0) {
+            first = got_data[0] | (got_data[1] << 8);
+            while (first + 0x10000UL <= RECORDS && epochs[first] != got_epoch) {
+                first += 0x10000U;
+            }
+        }
+        i = first + k;
+        CHECK(i < RECORDS && got_epoch == epochs[i] && got_ticks == ticks[i] &&
+              memcmp(got_data, data[i], 3) == 0, i);
+    }
+    CHECK(k > 0 && first + k == RECORDS, k);
+}
+
+int main(void)
+{
+    static const unsigned int per_block[] = { 1, 2, 17, 60 };
+    unsigned int f, p;
+
+    rtc_init_ex(RTC_CLOCK_XT1CLK, 0, 4, NULL);
+    srand(26);
+    for (f = 0; f < 4; f++) {
+        for (p = 0; p < sizeof(per_block) / sizeof(per_block[0]); p++) {
+            check_layout(f, per_block[p]);
+        }
+    }
+    return test_done("test_log");
+}
@@ -0,0 +1,134 @@
+/**
+  * MSP430 Real Time Clock Kit - timezones against the host's localtime_r()
+  *
+  * Each POSIX TZ string is handed to rtc_tz_parse() and to the host's TZ, and the offset, the
+  * DST flag and the next transition are compared over the whole 32-bit epoch.  Switching the
+  * zone back and forth checks that rtc_tz_set() leaves nothing of the old one in the cache.
+  *
+        BSD 2-Clause License
+
+        Copyright (c) 2021, Eric
+        All rights reserved.
+
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice,
+        this list of conditions and the following disclaimer in the documentation
+        and/or other materials provided with the distribution.
+
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+        AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+        IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+        DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+        FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+        DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+        SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+        CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+        OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+        OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <time.h>
+#include "rtckit.h"
+#include "test.h"
+
+/// Northern and southern DST, a half-hour zone and one without DST
+static const char * const zones[] = {
+    "EST5EDT,M3.2.0,M11.1.0",
+    "CET-1CEST,M3.5.0,M10.5.0/3",
+    "AEST-10AEDT,M10.1.0,M4.1.0/3",
+    "NZST-12NZDT,M9.5.0,M4.1.0/3",
+    "IST-5:30",
+    "UTC0",
+};
+
+/// Step between the epochs compared - prime, so it lands at every time of day in turn
+#define STEP 3571UL
+
+static void check_zone(const char *posix)
+{
+    struct rtcTimezone tz;
+    struct tm g;
+    time_t t;
+    unsigned long e, next;
+    unsigned int isdst;
+    long offset;
+
+    setenv("TZ", posix, 1);
+    tzset();
+    CHECK(rtc_tz_parse(posix, &tz) == 0, 0);
+    rtc_tz_set(&tz);
+
+    // Up to the last epoch there is - transitions past it never come
+    for (e = 90000; e < 0xFFFFFFFFUL - STEP; e += STEP) {
+        t = (time_t)e;
+        localtime_r(&t, &g);
+        offset = rtc_tz_offset(e, &isdst);
+        CHECK(offset == g.tm_gmtoff && isdst == (g.tm_isdst > 0), e);
+
+        next = rtc_tz_next_transition(e);
+        if (next != 0) {
+            CHECK(next > e && rtc_tz_offset(next - 1, NULL) == offset, e);
+            CHECK(rtc_tz_offset(next, NULL) != offset, e);
+        } else if (tz.std_offset == tz.dst_offset) {
+            CHECK(next == 0, e);
+        }
+    }
+}
+
+/// rtc_tz_set() empties the cache: the answer always belongs to the zone just set
+static void check_switch(void)
+{
+    struct rtcTimezone ny, sydney;
+    unsigned long e;
+    unsigned int isdst;
+
+    rtc_tz_parse(zones[0], &ny);
+    rtc_tz_parse(zones[2], &sydney);
+    for (e = 1000000000UL; e < 1100000000UL; e += 86400UL * 7 + 13) {
+        rtc_tz_set(&ny);
+        CHECK(rtc_tz_offset(e, &isdst) == (isdst ? -4 * 3600L : -5 * 3600L), e);
+        rtc_tz_set(&sydney);
+        CHECK(rtc_tz_offset(e, &isdst) == (isdst ? 11 * 3600L : 10 * 3600L), e);
+    }
+}
+
+/// A lookup in 2106 caches the last window, and a lookup back in a DST period still finds DST
+static void check_2106(void)
+{
+    struct rtcTimezone ny, sydney;
+    unsigned int isdst;
+
+    rtc_tz_parse(zones[0], &ny);
+    rtc_tz_parse(zones[2], &sydney);
+
+    rtc_tz_set(&ny);
+    CHECK(rtc_tz_offset(0xFFFFFFFFUL, &isdst) == -5 * 3600L && !isdst, 0xFFFFFFFFUL);
+    CHECK(rtc_tz_offset(4294000000UL, &isdst) == -5 * 3600L && !isdst, 4294000000UL);
+    CHECK(rtc_tz_next_transition(4294000000UL) == 0, 4294000000UL);
+    CHECK(rtc_tz_offset(1783000000UL, &isdst) == -4 * 3600L && isdst, 1783000000UL);  // July 2026
+
+    rtc_tz_set(&sydney);
+    CHECK(rtc_tz_offset(0xFFFFFFFFUL, &isdst) == 11 * 3600L && isdst, 0xFFFFFFFFUL);
+    CHECK(rtc_tz_offset(1783000000UL, &isdst) == 10 * 3600L && !isdst, 1783000000UL);
+    CHECK(rtc_tz_offset(1798000000UL, &isdst) == 11 * 3600L && isdst, 1798000000UL);  // Dec 2026
+}
+
+int main(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(zones) / sizeof(zones[0]); i++) {
+        check_zone(zones[i]);
+    }
+    check_switch();
+    check_2106();
+    return test_done("test_tz");
+}